@@ -0,0 +1,30 @@
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions to count the number of allocations. This is in its own
+// translation unit, so that compilers do not see through the calls in the measured code.
+
+namespace {
+
+size_t count = 0;
+
+}  // namespace
+
+size_t allocation_count() noexcept {
+  return count;
+}
+
+void* operator new(size_t size) {
+  ++count;
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc{};
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/cache.hpp>
+#include <anitomy/result.hpp>
+#include <anitomy/detail/cli.hpp>
+#include <anitomy/detail/json.hpp>
+#include <anitomy/detail/util.hpp>
+#include <anitomy/version.hpp>
+
+// Measures the throughput of the parser over the test data, along with each of its stages.
+//
+// Every input is a sample. Side-effect free operations are repeated a number of times per sample
+// to get above the resolution of the clock. Stages that modify the tokens are run once per sample,
+// after the preceding stages, and the overhead of reading the clock is subtracted instead.
+//
+// Results are printed as JSON, so that runs can be compared with other tools.
+
+// Defined in `allocations.cpp`, along with the replacement allocation functions
+size_t allocation_count() noexcept;
+
+namespace {
+
+using namespace anitomy::detail;
+using clock_t_ = std::chrono::steady_clock;
+
+// Keeps the compiler from optimizing away the results of the measured operations
+volatile size_t sink = 0;
+
+struct Benchmark {
+  std::string name;
+  std::vector<double> samples;  // nanoseconds per operation
+  size_t allocations = 0;
+};
+
+// State of the parser for a single input, so that each stage can be run on its own
+struct State {
+  Tokenizer<> tokenizer;
+  TokenIndex<> index;
+  std::vector<anitomy::Element> elements;
+  anitomy::Options options;
+
+  void prepare(std::string_view input) {
+    tokenizer.reset(input);
+    tokenizer.tokenize(options);
+    index.build(tokenizer.tokens());
+    elements.clear();
+  }
+
+  [[nodiscard]] std::span<Token> tokens() noexcept {
+    return tokenizer.tokens();
+  }
+
+  [[nodiscard]] bool contains(anitomy::ElementKind kind) const noexcept {
+    return std::ranges::any_of(elements, [kind](const auto& e) { return e.kind == kind; });
+  }
+};
+
+// Stages of `Parser::parse`, in the same order
+using stage_t = std::pair<std::string_view, std::function<void(State&)>>;
+
+const std::vector<stage_t> stages{
+    {"parse_file_extension",
+     [](State& s) { parse_file_extension(s.tokens(), s.options, s.elements); }},
+    {"parse_keywords", [](State& s) { parse_keywords(s.tokens(), s.options, s.elements); }},
+    {"parse_file_checksum", [](State& s) { parse_file_checksum(s.tokens(), s.elements); }},
+    {"parse_video_resolution", [](State& s) { parse_video_resolution(s.tokens(), s.elements); }},
+    {"parse_year", [](State& s) { parse_year(s.tokens(), s.index, s.elements); }},
+    {"parse_season", [](State& s) { parse_season(s.tokens(), s.index, s.elements); }},
+    {"parse_volume", [](State& s) { parse_volume(s.tokens(), s.index, s.elements); }},
+    {"parse_episode", [](State& s) { parse_episode(s.tokens(), s.index, s.elements); }},
+    {"parse_title", [](State& s) { parse_title(s.tokens(), s.index, s.elements); }},
+    {"parse_release_group",
+     [](State& s) {
+       if (!s.contains(anitomy::ElementKind::ReleaseGroup)) {
+         parse_release_group(s.tokens(), s.index, s.elements);
+       }
+     }},
+    {"parse_episode_title",
+     [](State& s) {
+       if (s.contains(anitomy::ElementKind::Episode)) {
+         parse_episode_title(s.tokens(), s.elements);
+       }
+     }},
+};
+
+class Runner final {
+public:
+  Runner(std::span<const std::string> inputs, size_t iterations, size_t repeat)
+      : inputs_{inputs}, iterations_{iterations}, repeat_{repeat} {
+    calibrate();
+  }
+
+  // Measures `op(input)` repeatedly. It must not have side effects that affect the next call.
+  template <typename Op>
+  void pure(std::string_view name, Op&& op) {
+    pure(name, [](std::string_view) { return true; }, std::forward<Op>(op));
+  }
+
+  // Same as above, after `setup(input)` returns true.
+  template <typename Setup, typename Op>
+  void pure(std::string_view name, Setup&& setup, Op&& op) {
+    measure(name, std::forward<Setup>(setup), std::forward<Op>(op), repeat_);
+  }
+
+  // Measures `op(input)` once per sample, after `setup(input)` returns true.
+  template <typename Setup, typename Op>
+  void staged(std::string_view name, Setup&& setup, Op&& op) {
+    measure(name, std::forward<Setup>(setup), std::forward<Op>(op), 1);
+  }
+
+  [[nodiscard]] json::Value report() const {
+    json::Value::array_t benchmarks;
+    for (const auto& benchmark : benchmarks_) {
+      benchmarks.emplace_back(summarize(benchmark));
+    }
+
+    json::Value::object_t root;
+    root.emplace("version", json::Value{std::string{anitomy::version()}});
+    root.emplace("inputs", json::Value{static_cast<int>(inputs_.size())});
+    root.emplace("iterations", json::Value{static_cast<int>(iterations_)});
+    root.emplace("repeat", json::Value{static_cast<int>(repeat_)});
+    root.emplace("clock_overhead_ns", json::Value{static_cast<float>(clock_overhead_)});
+    root.emplace("benchmarks", json::Value{std::move(benchmarks)});
+    return json::Value{std::move(root)};
+  }
+
+private:
+  template <typename Setup, typename Op>
+  void measure(std::string_view name, Setup&& setup, Op&& op, const size_t repeat) {
+    Benchmark benchmark{std::string{name}, {}, 0};
+    benchmark.samples.reserve(inputs_.size() * iterations_);
+
+    for (size_t n = 0; n < iterations_; ++n) {
+      for (const auto& input : inputs_) {
+        if (!setup(input)) continue;
+        const size_t allocations = allocation_count();
+        const auto start = clock_t_::now();
+        for (size_t r = 0; r < repeat; ++r) op(input);
+        const auto end = clock_t_::now();
+        benchmark.allocations += allocation_count() - allocations;
+        const double elapsed = std::chrono::duration<double, std::nano>(end - start).count();
+        benchmark.samples.push_back(std::max(elapsed - clock_overhead_, 0.0) / repeat);
+      }
+    }
+
+    benchmark.allocations /= repeat;
+    benchmarks_.emplace_back(std::move(benchmark));
+  }
+
+  void calibrate() {
+    std::vector<double> samples(10000);
+    for (auto& sample : samples) {
+      const auto start = clock_t_::now();
+      const auto end = clock_t_::now();
+      sample = std::chrono::duration<double, std::nano>(end - start).count();
+    }
+    std::ranges::sort(samples);
+    clock_overhead_ = samples[samples.size() / 2];
+  }
+
+  [[nodiscard]] static json::Value summarize(Benchmark benchmark) {
+    auto& samples = benchmark.samples;
+    std::ranges::sort(samples);
+
+    const auto count = samples.size();
+    const auto percentile = [&samples](const double p) {
+      if (samples.empty()) return 0.0;
+      return samples[std::min(static_cast<size_t>(p * samples.size()), samples.size() - 1)];
+    };
+    const double total = std::ranges::fold_left(samples, 0.0, std::plus{});
+    const double ns_per_op = count ? total / count : 0.0;
+    const double allocs_per_op = count ? 1.0 * benchmark.allocations / count : 0.0;
+
+    json::Value::object_t object;
+    object.emplace("name", json::Value{std::move(benchmark.name)});
+    object.emplace("ops", json::Value{static_cast<int>(count)});
+    object.emplace("ns_per_op", json::Value{static_cast<float>(ns_per_op)});
+    object.emplace("ops_per_sec", json::Value{static_cast<float>(ns_per_op ? 1e9 / ns_per_op : 0)});
+    object.emplace("allocs_per_op", json::Value{static_cast<float>(allocs_per_op)});
+    object.emplace("p50_ns", json::Value{static_cast<float>(percentile(0.50))});
+    object.emplace("p99_ns", json::Value{static_cast<float>(percentile(0.99))});
+    return json::Value{std::move(object)};
+  }
+
+  std::span<const std::string> inputs_;
+  size_t iterations_ = 0;
+  size_t repeat_ = 0;
+  double clock_overhead_ = 0;
+  std::vector<Benchmark> benchmarks_;
+};
+
+size_t to_size(const std::string& value, size_t default_value) {
+  const int number = to_int(value);
+  return number > 0 ? static_cast<size_t>(number) : default_value;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const CommandLine cli{argc, argv};
+
+  const std::string path{cli.input().empty() ? "data.json" : cli.input()};
+  const size_t iterations = to_size(cli.get("iterations"), 10);
+  const size_t repeat = to_size(cli.get("repeat"), 16);
+
+  std::string file;
+  if (!read_file(path, file)) {
+    std::println(std::cerr, "Cannot read test data: {}", path);
+    return 1;
+  }
+
+  auto data = json::parse(file);
+  if (!data.is_array()) {
+    std::println(std::cerr, "Invalid test data: {}", path);
+    return 1;
+  }
+
+  std::vector<std::string> inputs;
+  for (auto& item : data.as_array()) {
+    inputs.emplace_back(item.as_object()["input"].as_string());
+  }
+
+  Runner runner{inputs, iterations, repeat};
+
+  runner.pure("parse", [](std::string_view input) {
+    sink = sink + anitomy::parse(input).size();
+  });
+
+  {
+    anitomy::Engine engine;
+    runner.pure("engine", [&engine](std::string_view input) {
+      sink = sink + engine.parse(input).size();
+    });
+  }
+
+  {
+    // Every shape is parsed before it is measured, so that only replays are measured
+    anitomy::Engine engine{{.shape_capacity = 1 << 16}};
+    runner.pure(
+        "shape_engine",
+        [&engine](std::string_view input) {
+          std::ignore = engine.parse(input);
+          return true;
+        },
+        [&engine](std::string_view input) { sink = sink + engine.parse(input).size(); });
+  }
+
+  {
+    anitomy::Engine engine;
+    anitomy::Options options;
+    options.kinds = {anitomy::ElementKind::Title, anitomy::ElementKind::Episode};
+    runner.pure("engine_title_episode", [&engine, &options](std::string_view input) {
+      sink = sink + engine.parse(input, options).size();
+    });
+    options.kinds = {anitomy::ElementKind::VideoTerm, anitomy::ElementKind::AudioTerm};
+    runner.pure("engine_keywords", [&engine, &options](std::string_view input) {
+      sink = sink + engine.parse(input, options).size();
+    });
+  }
+
+  runner.pure("parse_result", [](std::string_view input) {
+    sink = sink + anitomy::parse_result(input).size();
+  });
+
+  {
+    // Every input is cached before it is measured, so that only hits are measured
+    anitomy::CachedParser parser{{.capacity = 1 << 30}};
+    runner.pure(
+        "cached_parse",
+        [&parser](std::string_view input) {
+          std::ignore = parser.parse(input);
+          return true;
+        },
+        [&parser](std::string_view input) { sink = sink + parser.parse(input)->size(); });
+  }
+
+  {
+    Tokenizer<> tokenizer;
+    runner.pure("tokenize", [&tokenizer](std::string_view input) {
+      tokenizer.reset(input);
+      tokenizer.tokenize({});
+      sink = sink + tokenizer.tokens().size();
+    });
+  }
+
+  {
+    Tokenizer<> tokenizer;
+    runner.pure(
+        "keyword_lookup",
+        [&tokenizer](std::string_view input) {
+          tokenizer.reset(input);
+          tokenizer.tokenize({});
+          return true;
+        },
+        [&tokenizer](std::string_view) {
+          for (const auto& token : tokenizer.tokens()) {
+            sink = sink + (keyword_trie.find(token.value) != nullptr);
+          }
+        });
+  }
+
+  {
+    State state;
+    runner.staged(
+        "token_index",
+        [&state](std::string_view input) {
+          state.prepare(input);
+          return true;
+        },
+        [&state](std::string_view) { state.index.build(state.tokens()); });
+  }
+
+  for (size_t k = 0; k < stages.size(); ++k) {
+    State state;
+    runner.staged(
+        stages[k].first,
+        [&state, k](std::string_view input) {
+          state.prepare(input);
+          for (size_t j = 0; j < k; ++j) stages[j].second(state);
+          return true;
+        },
+        [&state, k](std::string_view) { stages[k].second(state); });
+  }
+
+  // Measured on title ranges, which are the most common input to this function
+  {
+    State state;
+    std::span<Token> span;
+    const auto title_stage = std::ranges::find(stages, "parse_title", &stage_t::first);
+    runner.pure(
+        "build_element_value",
+        [&](std::string_view input) {
+          state.prepare(input);
+          for (auto it = stages.begin(); it != title_stage; ++it) it->second(state);
+          span = find_title(state.tokens(), state.index);
+          return !span.empty();
+        },
+        [&](std::string_view) {
+          sink = sink + build_element_value(span, KeepDelimiters::No).size();
+        });
+  }
+
+  std::println("{}", json::serialize(runner.report(), cli.contains("pretty")));
+
+  return 0;
+}
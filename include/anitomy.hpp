@@ -1,9 +1,15 @@
 #pragma once
 
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string_view>
 #include <vector>
 
 #include <anitomy/detail/parser.hpp>
+#include <anitomy/detail/profile.hpp>
+#include <anitomy/detail/scheduler.hpp>
+#include <anitomy/detail/shape.hpp>
 #include <anitomy/detail/tokenizer.hpp>
 #include <anitomy/element.hpp>
 #include <anitomy/format.hpp>
@@ -11,14 +17,103 @@
 
 namespace anitomy {
 
-inline std::vector<Element> parse(std::string_view input, Options options = {}) noexcept {
-  detail::Tokenizer tokenizer{input};
+// Tokens and elements are allocated with the given allocator.
+template <typename Allocator>
+inline auto parse(std::string_view input, Options options, const Allocator& allocator) noexcept {
+  detail::Tokenizer<Allocator> tokenizer{input, allocator};
   tokenizer.tokenize(options);
 
-  detail::Parser parser{tokenizer.tokens()};
+  detail::Parser<Allocator> parser{tokenizer.tokens()};
   parser.parse(options);
 
-  return parser.elements();
+  return std::move(parser.elements());
+}
+
+// Parsing is reentrant, so this function can be called concurrently from multiple threads.
+inline std::vector<Element> parse(std::string_view input, Options options = {}) noexcept {
+  return parse(input, options, std::allocator<char>{});
+}
+
+// Parses with options that are fixed at compile time, e.g. `parse<Options{.parse_title = false}>`.
+// The result is the same, but the stages that the options disable are not compiled in, which makes
+// for a smaller and faster binary when only one configuration is used.
+template <Options options, typename Allocator = std::allocator<char>>
+inline auto parse(std::string_view input, const Allocator& allocator = {}) noexcept {
+  detail::Tokenizer<Allocator> tokenizer{input, allocator};
+  tokenizer.tokenize(options);
+
+  detail::Parser<Allocator> parser{tokenizer.tokens()};
+  parser.parse(detail::StaticOptions<options>{});
+
+  return std::move(parser.elements());
+}
+
+namespace pmr {
+
+inline std::pmr::vector<Element> parse(
+    std::string_view input, Options options = {},
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) noexcept {
+  return anitomy::parse(input, options, std::pmr::polymorphic_allocator<char>{resource});
+}
+
+}  // namespace pmr
+
+// Keeps the token and element buffers around between calls, so that parsing a large number of
+// inputs one after another does not reallocate them every time. Not thread-safe; use a separate
+// engine for each thread.
+class Engine final {
+public:
+  Engine() noexcept = default;
+
+  explicit Engine(const EngineOptions& engine_options) noexcept
+      : shapes_{engine_options.shape_capacity} {
+  }
+
+  // The returned elements are valid until the next call.
+  inline const std::vector<Element>& parse(std::string_view input,
+                                           const Options& options = {}) noexcept {
+    tokenizer_.reset(input);
+    tokenizer_.tokenize(options);
+
+    parser_.reset(tokenizer_.tokens());
+
+    const auto* shape = shapes_.capacity() ? shapes_.find(parser_.tokens(), options) : nullptr;
+    if (shape && shape->is_replayable) {
+      ANITOMY_PROFILE_SCOPE(Replay);
+      detail::ShapeCache::replay(*shape, parser_.tokens(), parser_.elements());
+      return parser_.elements();
+    }
+
+    parser_.parse(options);
+
+    if (shapes_.capacity() && !shape) {
+      shapes_.insert(input, parser_.tokens(), parser_.elements());
+    }
+
+    return parser_.elements();
+  }
+
+private:
+  detail::Tokenizer<> tokenizer_;
+  detail::Parser<> parser_;
+  detail::ShapeCache shapes_;
+};
+
+// Parses the inputs in parallel, and returns the results in the same order. If a stop is requested
+// via `batch_options.stop_token`, the results of the inputs that were not parsed are left empty.
+inline std::vector<std::vector<Element>> parse_batch(std::span<const std::string_view> inputs,
+                                                     Options options = {},
+                                                     const BatchOptions& batch_options = {}) {
+  std::vector<std::vector<Element>> results(inputs.size());
+
+  detail::parallel_for(inputs.size(), batch_options.thread_count, batch_options.chunk_size,
+                       batch_options.stop_token, [&](const size_t first, const size_t last) {
+                         for (size_t i = first; i < last; ++i) {
+                           results[i] = parse(inputs[i], options);
+                         }
+                       });
+
+  return results;
 }
 
 }  // namespace anitomy
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/detail/mapped_file.hpp>
+#include <anitomy/detail/scheduler.hpp>
+#include <anitomy/detail/util.hpp>
+
+namespace anitomy {
+
+namespace detail {
+
+// A block of whole lines of a file, along with the number of its first line
+struct LineBlock {
+  std::string_view text;
+  size_t first_line;
+};
+
+// Cuts the text into blocks of whole lines, so that threads can parse them independently. The
+// lines are only counted, so that line numbers are known without parsing the blocks in order.
+inline std::vector<LineBlock> cut_line_blocks(std::string_view text, size_t& line_count) {
+  constexpr size_t block_size = 1 << 20;
+
+  std::vector<LineBlock> blocks;
+  line_count = 0;
+  while (!text.empty()) {
+    const auto block = take_lines(text, block_size);
+    blocks.emplace_back(block, line_count);
+    line_count += std::ranges::count(block, '\n') + !block.ends_with('\n');
+    text.remove_prefix(block.size());
+  }
+  return blocks;
+}
+
+template <typename Fn>
+void parse_line_blocks(const std::vector<LineBlock>& blocks, const Options& options,
+                       const BatchOptions& batch_options, Fn&& fn) {
+  WorkerPool pool{batch_options.thread_count};
+  std::vector<Engine> engines(pool.size());
+
+  pool.run(blocks.size(), 1, [&](const size_t worker, const size_t first, const size_t last) {
+    auto& engine = engines[worker];
+    for (size_t i = first; i < last && !batch_options.stop_token.stop_requested(); ++i) {
+      size_t line_number = blocks[i].first_line;
+      for_each_line(blocks[i].text, [&](std::string_view line) {
+        fn(line_number++, line, engine.parse(line, options));
+      });
+    }
+  });
+}
+
+}  // namespace detail
+
+// Parses each line of the file in parallel, and calls `fn(line_number, line, elements)` for each
+// line (numbered from 0) on the thread that parsed it, so `fn` must be thread-safe. The file is
+// memory-mapped and cut into blocks of whole lines, which are parsed in place, so it can be larger
+// than the available memory. The line and the elements are valid until `fn` returns. Line breaks
+// (`\n` or `\r\n`) are not a part of the line. `batch_options.chunk_size` is not used, as threads
+// claim blocks of about 1 MiB instead. If a stop is requested, the remaining blocks are skipped.
+// Returns false if the file cannot be opened.
+template <typename Fn>
+inline bool parse_file_lines(const std::string& path, Options options,
+                             const BatchOptions& batch_options, Fn&& fn) {
+  const detail::MappedFile file{path};
+  if (!file.is_open()) return false;
+
+  size_t line_count = 0;
+  const auto blocks = detail::cut_line_blocks(file.view(), line_count);
+  detail::parse_line_blocks(blocks, options, batch_options, fn);
+  return true;
+}
+
+// Same as above, but returns the results of all lines, in the same order. If a stop is requested,
+// the results of the lines that were not parsed are left empty.
+inline std::optional<std::vector<std::vector<Element>>> parse_file_lines(
+    const std::string& path, Options options = {}, const BatchOptions& batch_options = {}) {
+  const detail::MappedFile file{path};
+  if (!file.is_open()) return std::nullopt;
+
+  size_t line_count = 0;
+  const auto blocks = detail::cut_line_blocks(file.view(), line_count);
+  std::vector<std::vector<Element>> results(line_count);
+  detail::parse_line_blocks(blocks, options, batch_options,
+                            [&results](const size_t line_number, std::string_view,
+                                       const std::vector<Element>& elements) {
+                              results[line_number] = elements;
+                            });
+  return results;
+}
+
+}  // namespace anitomy
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/detail/options.hpp>
+
+namespace anitomy {
+
+struct CacheOptions {
+  size_t capacity = 64 << 20;  // approximate number of bytes that the entries can take in total
+  size_t shard_count = 16;     // number of independently locked parts
+};
+
+struct CacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  size_t entries = 0;
+  size_t memory = 0;  // approximate number of bytes that the entries take
+};
+
+// Remembers the results of recently parsed inputs, so that parsing the same input again is a hash
+// lookup. Entries are spread across shards by the hash of the input and the options, and each shard
+// has its own lock and evicts its least recently used entries once it exceeds its share of the
+// capacity. Thread-safe.
+class CachedParser final {
+public:
+  using result_t = std::shared_ptr<const std::vector<Element>>;
+
+  explicit CachedParser(const CacheOptions& options = {})
+      : shard_count_{std::max<size_t>(options.shard_count, 1)},
+        shard_capacity_{options.capacity / shard_count_},
+        shards_{std::make_unique<Shard[]>(shard_count_)} {
+  }
+
+  // Results are shared with the cache, and stay valid after they are evicted.
+  [[nodiscard]] inline result_t parse(std::string_view input, const Options& options = {}) {
+    const uint32_t fingerprint = detail::fingerprint(options);
+    const uint64_t hash = std::hash<std::string_view>{}(input) ^ (uint64_t{fingerprint} << 32);
+    auto& shard = shards_[(hash >> 7) % shard_count_];
+
+    {
+      std::lock_guard lock{shard.mutex};
+      if (const auto it = shard.index.find(hash); it != shard.index.end()) {
+        const auto& entry = *it->second;
+        if (entry.fingerprint == fingerprint && entry.input == input) {
+          shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+          ++shard.stats.hits;
+          return entry.result;
+        }
+      }
+      ++shard.stats.misses;
+    }
+
+    // Parsed without holding the lock, so that other inputs of the shard are not blocked
+    auto result = std::make_shared<const std::vector<Element>>(anitomy::parse(input, options));
+
+    std::lock_guard lock{shard.mutex};
+    if (const auto it = shard.index.find(hash); it != shard.index.end()) {
+      remove(shard, it->second);  // a collision, or parsed by another thread in the meantime
+    }
+    shard.entries.emplace_front(std::string{input}, fingerprint, hash, result, 0);
+    auto& entry = shard.entries.front();
+    entry.size = entry_size(entry);
+    shard.index.emplace(hash, shard.entries.begin());
+    shard.stats.memory += entry.size;
+    while (shard.stats.memory > shard_capacity_ && !shard.entries.empty()) {
+      remove(shard, std::prev(shard.entries.end()));
+      ++shard.stats.evictions;
+    }
+    return result;
+  }
+
+  [[nodiscard]] inline CacheStats stats() const {
+    CacheStats stats;
+    for (size_t i = 0; i < shard_count_; ++i) {
+      auto& shard = shards_[i];
+      std::lock_guard lock{shard.mutex};
+      stats.hits += shard.stats.hits;
+      stats.misses += shard.stats.misses;
+      stats.evictions += shard.stats.evictions;
+      stats.entries += shard.entries.size();
+      stats.memory += shard.stats.memory;
+    }
+    return stats;
+  }
+
+  // Removes all entries, and resets the counters
+  inline void clear() {
+    for (size_t i = 0; i < shard_count_; ++i) {
+      auto& shard = shards_[i];
+      std::lock_guard lock{shard.mutex};
+      shard.entries.clear();
+      shard.index.clear();
+      shard.stats = {};
+    }
+  }
+
+private:
+  struct Entry {
+    std::string input;
+    uint32_t fingerprint;
+    uint64_t hash;
+    result_t result;
+    size_t size;
+  };
+
+  using entry_iterator = std::list<Entry>::iterator;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<uint64_t, entry_iterator> index;
+    CacheStats stats;
+  };
+
+  // Includes the list and map nodes, and the strings that do not fit in their inline buffer
+  [[nodiscard]] static size_t entry_size(const Entry& entry) noexcept {
+    static constexpr size_t node_overhead = 4 * sizeof(void*);
+    size_t size = sizeof(Entry) + node_overhead + sizeof(uint64_t) + sizeof(entry_iterator) +
+                  node_overhead + entry.input.capacity() + sizeof(std::vector<Element>) +
+                  entry.result->capacity() * sizeof(Element);
+    for (const auto& element : *entry.result) {
+      if (element.value.capacity() > std::string{}.capacity()) size += element.value.capacity();
+    }
+    return size;
+  }
+
+  static void remove(Shard& shard, const entry_iterator it) {
+    shard.stats.memory -= it->size;
+    shard.index.erase(it->hash);
+    shard.entries.erase(it);
+  }
+
+  size_t shard_count_;
+  size_t shard_capacity_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace anitomy
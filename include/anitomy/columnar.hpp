@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/keyword.hpp>
+
+namespace anitomy {
+
+// An element of a `ColumnarResult`, which refers to its storage instead of owning a copy of it
+struct ElementView {
+  ElementKind kind;
+  std::string_view value;
+  size_t position;
+  size_t input;  // index of the input that the element belongs to
+
+  bool operator==(const ElementView&) const = default;
+};
+
+// Holds the results of a batch of inputs in columns, so that millions of them take a small fraction
+// of the memory of `std::vector<std::vector<Element>>`. Each element takes 9 bytes in the columns.
+// All values are stored in a single buffer, and values of kinds that repeat across inputs (e.g.
+// titles, release groups or video terms) are stored only once, and share the same value ID. Values
+// that are spelled as a keyword (see `Options::canonical_keywords`) are not stored at all, and their
+// value ID is the `KeywordId`, which is the same in all results.
+class ColumnarResult final {
+public:
+  // Kinds whose values are unique to almost every input are not worth looking up
+  [[nodiscard]] static constexpr bool is_dictionary_kind(const ElementKind kind) noexcept {
+    using enum ElementKind;
+    return kind != EpisodeTitle && kind != FileChecksum;
+  }
+
+  // Appends the elements of the next input
+  inline void append(std::span<const Element> elements) {
+    for (const auto& element : elements) {
+      push_back(element.kind, element.value, element.position);
+    }
+    input_offsets_.push_back(static_cast<uint32_t>(kinds_.size()));
+  }
+
+  // Appends all inputs of the other result
+  inline void append(const ColumnarResult& other) {
+    for (size_t input = 0; input < other.input_count(); ++input) {
+      const auto [first, last] = other.element_range(input);
+      for (size_t i = first; i < last; ++i) {
+        push_back(other.kind(i), other.value(i), other.position(i));
+      }
+      input_offsets_.push_back(static_cast<uint32_t>(kinds_.size()));
+    }
+  }
+
+  // Removes all inputs, keeping the capacity of the columns
+  inline void clear() noexcept {
+    input_offsets_.resize(1);
+    kinds_.clear();
+    positions_.clear();
+    value_ids_.clear();
+    string_blocks_.clear();
+    string_ends_.clear();
+    strings_.clear();
+    dictionary_.clear();
+  }
+
+  inline void reserve(const size_t input_count, const size_t element_count) {
+    input_offsets_.reserve(input_count + 1);
+    kinds_.reserve(element_count);
+    positions_.reserve(element_count);
+    value_ids_.reserve(element_count);
+  }
+
+  // Number of inputs
+  [[nodiscard]] constexpr size_t input_count() const noexcept {
+    return input_offsets_.size() - 1;
+  }
+
+  // Number of elements, in all inputs
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    return kinds_.size();
+  }
+
+  [[nodiscard]] constexpr ElementKind kind(const size_t i) const noexcept {
+    return static_cast<ElementKind>(kinds_[i]);
+  }
+
+  [[nodiscard]] constexpr size_t position(const size_t i) const noexcept {
+    return positions_[i];
+  }
+
+  [[nodiscard]] constexpr uint32_t value_id(const size_t i) const noexcept {
+    return value_ids_[i];
+  }
+
+  [[nodiscard]] constexpr std::string_view value(const size_t i) const noexcept {
+    return string(value_ids_[i]);
+  }
+
+  // Number of values that are stored, excluding keywords
+  [[nodiscard]] constexpr size_t string_count() const noexcept {
+    return string_ends_.size();
+  }
+
+  [[nodiscard]] constexpr std::string_view string(uint32_t id) const noexcept {
+    if (id < keyword_count) return keyword_value(static_cast<KeywordId>(id));
+    id -= keyword_count;
+    const size_t first = id % string_block_size ? string_ends_[id - 1] : 0;
+    return std::string_view{strings_}.substr(string_blocks_[id / string_block_size] + first,
+                                             string_ends_[id] - first);
+  }
+
+  // Returns the range of element indexes that belong to the input
+  [[nodiscard]] constexpr std::pair<size_t, size_t> element_range(
+      const size_t input) const noexcept {
+    return {input_offsets_[input], input_offsets_[input + 1]};
+  }
+
+  [[nodiscard]] constexpr ElementView element(const size_t i, const size_t input) const noexcept {
+    return {.kind = kind(i), .value = value(i), .position = position(i), .input = input};
+  }
+
+  [[nodiscard]] auto elements(const size_t input) const noexcept {
+    const auto [first, last] = element_range(input);
+    return std::views::iota(first, last) |
+           std::views::transform([this, input](const size_t i) { return element(i, input); });
+  }
+
+  // Allocates the elements of the input, which the rest of the library works with
+  [[nodiscard]] inline std::vector<Element> to_elements(const size_t input) const {
+    std::vector<Element> elements;
+    for (const auto element : this->elements(input)) {
+      elements.emplace_back(element.kind, std::string{element.value}, element.position);
+    }
+    return elements;
+  }
+
+  // Visits all elements in order, keeping track of the input that they belong to
+  class Iterator final {
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = ElementView;
+
+    Iterator() noexcept = default;
+
+    Iterator(const ColumnarResult* result, size_t index) noexcept
+        : result_{result}, index_{index} {
+      skip_finished_inputs();
+    }
+
+    [[nodiscard]] ElementView operator*() const noexcept {
+      return result_->element(index_, input_);
+    }
+
+    Iterator& operator++() noexcept {
+      ++index_;
+      skip_finished_inputs();
+      return *this;
+    }
+
+    Iterator operator++(int) noexcept {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    bool operator==(const Iterator& other) const noexcept {
+      return index_ == other.index_;
+    }
+
+  private:
+    void skip_finished_inputs() noexcept {
+      const auto& offsets = result_->input_offsets_;
+      while (input_ + 1 < offsets.size() - 1 && offsets[input_ + 1] <= index_) ++input_;
+    }
+
+    const ColumnarResult* result_ = nullptr;
+    size_t index_ = 0;
+    size_t input_ = 0;
+  };
+
+  [[nodiscard]] Iterator begin() const noexcept {
+    return {this, 0};
+  }
+
+  [[nodiscard]] Iterator end() const noexcept {
+    return {this, size()};
+  }
+
+  // Approximate number of bytes that are in use, excluding the dictionary
+  [[nodiscard]] constexpr size_t memory_usage() const noexcept {
+    return input_offsets_.size() * sizeof(uint32_t) + kinds_.size() * sizeof(uint8_t) +
+           positions_.size() * sizeof(uint32_t) + value_ids_.size() * sizeof(uint32_t) +
+           string_blocks_.size() * sizeof(uint64_t) + string_ends_.size() * sizeof(uint32_t) +
+           strings_.size();
+  }
+
+private:
+  // Number of strings whose ends are relative to the same offset, so that they fit in 32 bits as
+  // long as the values average less than 4 MiB
+  static constexpr size_t string_block_size = 1024;
+
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const noexcept {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  inline void push_back(const ElementKind kind, std::string_view value, const size_t position) {
+    kinds_.push_back(static_cast<uint8_t>(kind));
+    positions_.push_back(static_cast<uint32_t>(position));
+    value_ids_.push_back(intern(kind, value));
+  }
+
+  inline uint32_t add_string(std::string_view value) {
+    const size_t id = string_ends_.size();
+    if (id % string_block_size == 0) string_blocks_.push_back(strings_.size());
+    strings_.append(value);
+    string_ends_.push_back(static_cast<uint32_t>(strings_.size() - string_blocks_.back()));
+    return static_cast<uint32_t>(keyword_count + id);
+  }
+
+  inline uint32_t intern(const ElementKind kind, std::string_view value) {
+    if (!is_dictionary_kind(kind)) return add_string(value);
+    if (const auto id = find_keyword(value)) return *id;
+    if (const auto it = dictionary_.find(value); it != dictionary_.end()) return it->second;
+    const uint32_t id = add_string(value);
+    dictionary_.emplace(value, id);
+    return id;
+  }
+
+  std::vector<uint32_t> input_offsets_{0};  // first element of each input, and the end
+  std::vector<uint8_t> kinds_;
+  std::vector<uint32_t> positions_;
+  std::vector<uint32_t> value_ids_;
+  std::vector<uint64_t> string_blocks_;  // offset of each block of strings
+  std::vector<uint32_t> string_ends_;    // end of each string, from the offset of its block
+  std::string strings_;
+  std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> dictionary_;
+};
+
+// Parses the inputs in parallel, like `parse_batch`, into columns. If a stop is requested via
+// `batch_options.stop_token`, the inputs that were not parsed have no elements.
+inline ColumnarResult parse_batch_columnar(std::span<const std::string_view> inputs,
+                                           Options options = {},
+                                           const BatchOptions& batch_options = {}) {
+  detail::WorkerPool pool{batch_options.thread_count};
+  std::vector<Engine> engines(pool.size());
+
+  // Inputs are parsed a window at a time into chunks, which are appended in input order and cleared
+  // right away, so that only the chunks of one window are held in memory besides the result
+  const size_t chunk_size = std::clamp<size_t>(batch_options.chunk_size, 1, inputs.size() + 1);
+  const size_t window_size = chunk_size * pool.size() * 16;
+  std::vector<ColumnarResult> chunks;
+
+  ColumnarResult result;
+  for (size_t offset = 0; offset < inputs.size(); offset += window_size) {
+    const auto window = inputs.subspan(offset, std::min(window_size, inputs.size() - offset));
+    const auto chunk_inputs = [&](const size_t i) {
+      return window.subspan(i * chunk_size, std::min(chunk_size, window.size() - i * chunk_size));
+    };
+
+    chunks.resize((window.size() + chunk_size - 1) / chunk_size);
+    pool.run(chunks.size(), 1, [&](const size_t worker, const size_t first, const size_t last) {
+      for (size_t i = first; i < last && !batch_options.stop_token.stop_requested(); ++i) {
+        for (const auto input : chunk_inputs(i)) {
+          chunks[i].append(engines[worker].parse(input, options));
+        }
+      }
+    });
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      result.append(chunks[i]);
+      chunks[i].clear();
+      const size_t input_count = offset + i * chunk_size + chunk_inputs(i).size();
+      while (result.input_count() < input_count) result.append(std::span<const Element>{});
+    }
+  }
+
+  return result;
+}
+
+}  // namespace anitomy
@@ -58,7 +58,8 @@ private:
       if (!option.empty()) options_[option] = value;
     }
 
-    if (options_.contains("stdin")) {
+    // In batch mode, standard input is read line by line later on
+    if (options_.contains("stdin") && !options_.contains("batch")) {
       std::getline(std::cin, input_);
     }
   }
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <anitomy/detail/element.hpp>
+#include <anitomy/detail/format.hpp>
+#include <anitomy/detail/json/escape.hpp>
+#include <anitomy/element.hpp>
+
+// Writers that serialize elements straight into an output buffer, without building an intermediate
+// `json::Value`. They append to the buffer, so that it can be reused for any number of records.
+//
+// JSON, CSV and TSV records have a single value for each kind, which is the first element of that
+// kind, and they are ordered by kind. Binary records have all elements in their original order.
+
+namespace anitomy::detail {
+
+enum class OutputFormat {
+  Json,
+  Csv,
+  Tsv,
+  Binary,
+};
+
+[[nodiscard]] constexpr std::optional<OutputFormat> to_output_format(std::string_view name) {
+  if (name == "json") return OutputFormat::Json;
+  if (name == "csv") return OutputFormat::Csv;
+  if (name == "tsv") return OutputFormat::Tsv;
+  if (name == "binary") return OutputFormat::Binary;
+  return std::nullopt;
+}
+
+// Returns the first element of each kind, indexed by kind
+[[nodiscard]] inline auto first_of_each_kind(std::span<const Element> elements) noexcept {
+  std::array<const Element*, element_kind_count> found{};
+  for (const auto& element : elements) {
+    auto& first = found[static_cast<size_t>(element.kind)];
+    if (!first) first = &element;
+  }
+  return found;
+}
+
+// JSON
+
+inline void write_json_string(std::string_view value, std::string& output) {
+  output.push_back('"');
+  json::append_escaped(value, output);
+  output.push_back('"');
+}
+
+// e.g. `{"episode":"01","title":"Toradora!"}`
+inline void write_json(std::span<const Element> elements, std::string& output) {
+  output.push_back('{');
+  bool first = true;
+  for (size_t kind = 0; const auto* element : first_of_each_kind(elements)) {
+    if (element) {
+      if (!first) output.push_back(',');
+      write_json_string(to_string(static_cast<ElementKind>(kind)), output);
+      output.push_back(':');
+      write_json_string(element->value, output);
+      first = false;
+    }
+    ++kind;
+  }
+  output.push_back('}');
+}
+
+// CSV (RFC 4180)
+//
+// Fields that contain a separator, a quote or a line break are quoted, with quotes doubled.
+
+inline void write_csv_field(std::string_view value, std::string& output) {
+  if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+    output.append(value);
+    return;
+  }
+  output.push_back('"');
+  for (size_t first = 0;;) {
+    const size_t quote = value.find('"', first);
+    output.append(value.substr(first, quote - first));
+    if (quote == std::string_view::npos) break;
+    output.append("\"\"");
+    first = quote + 1;
+  }
+  output.push_back('"');
+}
+
+// TSV
+//
+// Tabs, line breaks and backslashes in values are escaped as `\t`, `\n`, `\r` and `\\`.
+
+inline void write_tsv_field(std::string_view value, std::string& output) {
+  size_t first = 0;
+  for (size_t i = 0; i < value.size(); ++i) {
+    char escape = 0;
+    // clang-format off
+    switch (value[i]) {
+      case '\t': escape = 't'; break;
+      case '\n': escape = 'n'; break;
+      case '\r': escape = 'r'; break;
+      case '\\': escape = '\\'; break;
+      default: continue;
+    }
+    // clang-format on
+    output.append(value.substr(first, i - first));
+    output.push_back('\\');
+    output.push_back(escape);
+    first = i + 1;
+  }
+  output.append(value.substr(first));
+}
+
+// Writes the names of all element kinds, e.g. `audio_term,device_compatibility,...,year`
+inline void write_separated_header(const char separator, std::string& output) {
+  for (size_t kind = 0; kind < element_kind_count; ++kind) {
+    if (kind) output.push_back(separator);
+    output.append(to_string(static_cast<ElementKind>(kind)));
+  }
+}
+
+// Writes a value for each element kind, which is empty if there is no element of that kind
+inline void write_separated(std::span<const Element> elements, const char separator,
+                            std::string& output) {
+  for (size_t kind = 0; const auto* element : first_of_each_kind(elements)) {
+    if (kind++) output.push_back(separator);
+    if (!element) continue;
+    if (separator == '\t') {
+      write_tsv_field(element->value, output);
+    } else {
+      write_csv_field(element->value, output);
+    }
+  }
+}
+
+// Binary
+//
+// Integers are little-endian. A record is written as:
+//
+//   record  = size:u32 count:u16 element*  (size is the number of bytes that follow it)
+//   element = kind:u8 position:u32 length:u32 value:u8[length]
+//   string  = length:u32 value:u8[length]
+
+template <typename T>
+inline void write_binary_integer(const T value, std::string& output) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    output.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+inline void write_binary_string(std::string_view value, std::string& output) {
+  write_binary_integer(static_cast<uint32_t>(value.size()), output);
+  output.append(value);
+}
+
+inline void write_binary(std::span<const Element> elements, std::string& output) {
+  const size_t offset = output.size();
+  write_binary_integer(uint32_t{0}, output);  // written below, once the size is known
+  write_binary_integer(static_cast<uint16_t>(elements.size()), output);
+  for (const auto& element : elements) {
+    write_binary_integer(static_cast<uint8_t>(element.kind), output);
+    write_binary_integer(static_cast<uint32_t>(element.position), output);
+    write_binary_string(element.value, output);
+  }
+  const auto size = static_cast<uint32_t>(output.size() - offset - sizeof(uint32_t));
+  for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+    output[offset + i] = static_cast<char>((size >> (i * 8)) & 0xff);
+  }
+}
+
+template <typename T>
+inline bool read_binary_integer(std::string_view& input, T& value) noexcept {
+  if (input.size() < sizeof(T)) return false;
+  value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    value |= static_cast<T>(static_cast<T>(static_cast<unsigned char>(input[i])) << (i * 8));
+  }
+  input.remove_prefix(sizeof(T));
+  return true;
+}
+
+// The value is a slice of the input
+inline bool read_binary_string(std::string_view& input, std::string_view& value) noexcept {
+  uint32_t size = 0;
+  if (!read_binary_integer(input, size) || input.size() < size) return false;
+  value = input.substr(0, size);
+  input.remove_prefix(size);
+  return true;
+}
+
+// Reads a record that was written with `write_binary`, and removes it from the input. Returns false
+// if the record is incomplete or malformed.
+inline bool read_binary(std::string_view& input, std::vector<Element>& elements) {
+  uint32_t size = 0;
+  if (!read_binary_integer(input, size) || input.size() < size) return false;
+  auto record = input.substr(0, size);
+
+  uint16_t count = 0;
+  if (!read_binary_integer(record, count)) return false;
+  elements.clear();
+  elements.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t kind = 0;
+    uint32_t position = 0;
+    std::string_view value;
+    if (!read_binary_integer(record, kind) || kind >= element_kind_count ||
+        !read_binary_integer(record, position) || !read_binary_string(record, value)) {
+      return false;
+    }
+    elements.emplace_back(static_cast<ElementKind>(kind), std::string{value}, position);
+  }
+  if (!record.empty()) return false;
+
+  input.remove_prefix(size);
+  return true;
+}
+
+// Writes the header, if the format has one. Records of files start with their path.
+inline void write_header(const OutputFormat format, const bool with_path, std::string& output) {
+  if (format != OutputFormat::Csv && format != OutputFormat::Tsv) return;
+  const char separator = format == OutputFormat::Csv ? ',' : '\t';
+  if (with_path) {
+    output.append("path");
+    output.push_back(separator);
+  }
+  write_separated_header(separator, output);
+  output.push_back('\n');
+}
+
+// Writes a record, followed by a line break in text formats.
+inline void write_record(const OutputFormat format, std::span<const Element> elements,
+                         std::string& output) {
+  switch (format) {
+    case OutputFormat::Json:
+      write_json(elements, output);
+      output.push_back('\n');
+      break;
+    case OutputFormat::Csv:
+      write_separated(elements, ',', output);
+      output.push_back('\n');
+      break;
+    case OutputFormat::Tsv:
+      write_separated(elements, '\t', output);
+      output.push_back('\n');
+      break;
+    case OutputFormat::Binary:
+      write_binary(elements, output);
+      break;
+  }
+}
+
+// Writes a record of a file, e.g. `{"path":"...","elements":{...}}` in JSON. In the binary format,
+// the path is written as a string before the record.
+inline void write_record(const OutputFormat format, std::string_view path,
+                         std::span<const Element> elements, std::string& output) {
+  switch (format) {
+    case OutputFormat::Json:
+      output.append(R"({"path":)");
+      write_json_string(path, output);
+      output.append(R"(,"elements":)");
+      write_json(elements, output);
+      output.append("}\n");
+      break;
+    case OutputFormat::Csv:
+      write_csv_field(path, output);
+      output.push_back(',');
+      write_record(format, elements, output);
+      break;
+    case OutputFormat::Tsv:
+      write_tsv_field(path, output);
+      output.push_back('\t');
+      write_record(format, elements, output);
+      break;
+    case OutputFormat::Binary:
+      write_binary_string(path, output);
+      write_binary(elements, output);
+      break;
+  }
+}
+
+}  // namespace anitomy::detail
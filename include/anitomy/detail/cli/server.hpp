@@ -0,0 +1,323 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <anitomy.hpp>
+#include <anitomy/detail/cli/output.hpp>
+#include <anitomy/detail/scheduler.hpp>
+
+// A long-lived process that parses filenames for other processes over a Unix domain socket.
+//
+// Integers are little-endian. A client sends any number of requests on a connection, and receives
+// a response for each, in the same order:
+//
+//   request  = count:u32 string*  (string = length:u32 value:u8[length])
+//   response = size:u32 record*   (size is the number of bytes that follow it)
+//
+// The response has a record for each name in the request, in the same order, written in the output
+// format of the server (see `output.hpp`). Text formats have no header, and each record ends with a
+// line break.
+//
+// Requests that arrive while a batch is being parsed are coalesced into the next batch, which is
+// spread across a pool of threads that each keep their own `Engine`.
+
+namespace anitomy::detail {
+
+#ifdef MSG_NOSIGNAL
+inline constexpr int socket_send_flags = MSG_NOSIGNAL;
+#else
+inline constexpr int socket_send_flags = 0;
+#endif
+
+// Limits the memory that a single request can take
+inline constexpr size_t max_request_size = 1 << 26;
+
+inline bool read_exact(const int fd, char* data, size_t size) noexcept {
+  while (size) {
+    const ssize_t count = ::recv(fd, data, size, 0);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    data += count;
+    size -= static_cast<size_t>(count);
+  }
+  return true;
+}
+
+inline bool write_all(const int fd, std::string_view data) noexcept {
+  while (!data.empty()) {
+    const ssize_t count = ::send(fd, data.data(), data.size(), socket_send_flags);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    data.remove_prefix(static_cast<size_t>(count));
+  }
+  return true;
+}
+
+inline std::optional<uint32_t> read_u32(const int fd) noexcept {
+  unsigned char bytes[4];
+  if (!read_exact(fd, reinterpret_cast<char*>(bytes), sizeof(bytes))) return std::nullopt;
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// Returns a socket that is connected to the given path, or -1
+inline int connect_socket(const std::string& path) noexcept {
+  sockaddr_un address{};
+  if (path.size() >= sizeof(address.sun_path)) return -1;
+  address.sun_family = AF_UNIX;
+  path.copy(address.sun_path, path.size());
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) return -1;
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+class Server final {
+public:
+  Server(const Options& options, const OutputFormat format, const size_t thread_count,
+         const EngineOptions& engine_options = {})
+      : options_{options}, format_{format}, pool_{thread_count} {
+    engines_.reserve(pool_.size());
+    for (size_t i = 0; i < pool_.size(); ++i) {
+      engines_.emplace_back(engine_options);
+    }
+  }
+
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  ~Server() {
+    if (listener_ != -1) {
+      ::close(listener_);
+      ::unlink(path_.c_str());
+    }
+  }
+
+  // Binds the socket to the path. A stale socket at the path is replaced, but other files are not.
+  inline bool listen(const std::string& path) noexcept {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, path.size());
+
+    struct stat status{};
+    if (::stat(path.c_str(), &status) == 0) {
+      if (!S_ISSOCK(status.st_mode)) return false;
+      if (const int fd = connect_socket(path); fd != -1) {
+        ::close(fd);
+        return false;  // another server is listening
+      }
+      ::unlink(path.c_str());
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return false;
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 ||
+        ::listen(fd, SOMAXCONN) == -1) {
+      ::close(fd);
+      return false;
+    }
+
+    listener_ = fd;
+    path_ = path;
+    return true;
+  }
+
+  // Accepts connections until a stop is requested, and then closes them
+  inline void run(const std::stop_token& stop_token) {
+    std::list<Connection> connections;
+
+    {
+      std::jthread dispatcher{[this](const std::stop_token& token) { dispatch(token); }};
+
+      pollfd listener{.fd = listener_, .events = POLLIN, .revents = 0};
+      while (!stop_token.stop_requested()) {
+        std::erase_if(connections, [](const Connection& c) { return c.done.load(); });
+        // Wakes up periodically to check for a stop request
+        if (::poll(&listener, 1, 100) <= 0) continue;
+        const int fd = ::accept(listener_, nullptr, nullptr);
+        if (fd == -1) continue;
+        auto& connection = connections.emplace_back(fd);
+        connection.thread = std::jthread{[this, &connection] { serve(connection); }};
+      }
+    }
+
+    // The dispatcher has stopped, so requests that are still pending are not answered
+    {
+      std::lock_guard lock{mutex_};
+      stopped_ = true;
+      for (auto* request : pending_) request->done = true;
+      pending_.clear();
+    }
+    request_done_.notify_all();
+
+    for (auto& connection : connections) {
+      ::shutdown(connection.fd, SHUT_RDWR);
+    }
+  }
+
+private:
+  struct Connection {
+    explicit Connection(int fd) noexcept : fd{fd} {
+    }
+    ~Connection() {
+      if (thread.joinable()) thread.join();
+      ::close(fd);
+    }
+    int fd = -1;
+    std::atomic<bool> done = false;
+    std::jthread thread;
+  };
+
+  struct Request {
+    std::string data;
+    std::vector<std::pair<size_t, size_t>> names;  // offsets and lengths in `data`
+    std::string response;
+    bool done = false;
+  };
+
+  // Reads requests from the connection, and writes back their responses
+  inline void serve(Connection& connection) {
+    Request request;
+    while (read_request(connection.fd, request)) {
+      if (!submit(request)) break;
+      if (!write_all(connection.fd, request.response)) break;
+    }
+    connection.done = true;
+  }
+
+  inline static bool read_request(const int fd, Request& request) {
+    request.data.clear();
+    request.names.clear();
+    const auto count = read_u32(fd);
+    if (!count || *count > max_request_size / sizeof(uint32_t)) return false;
+    for (uint32_t i = 0; i < *count; ++i) {
+      const auto length = read_u32(fd);
+      if (!length || request.data.size() + *length > max_request_size) return false;
+      const size_t offset = request.data.size();
+      request.data.resize(offset + *length);
+      if (!read_exact(fd, request.data.data() + offset, *length)) return false;
+      request.names.emplace_back(offset, *length);
+    }
+    return true;
+  }
+
+  // Queues the request for the next batch, and waits for its response
+  inline bool submit(Request& request) {
+    std::unique_lock lock{mutex_};
+    if (stopped_) return false;
+    request.response.assign(sizeof(uint32_t), '\0');  // size is written once known
+    request.done = false;
+    pending_.push_back(&request);
+    request_ready_.notify_one();
+    request_done_.wait(lock, [&] { return request.done; });
+    return !stopped_;
+  }
+
+  inline void dispatch(const std::stop_token& stop_token) {
+    std::vector<Request*> batch;
+    std::vector<std::string_view> names;
+    std::vector<std::string> records;
+
+    while (true) {
+      {
+        std::unique_lock lock{mutex_};
+        if (!request_ready_.wait(lock, stop_token, [this] { return !pending_.empty(); })) return;
+        batch.swap(pending_);
+      }
+
+      names.clear();
+      for (const auto* request : batch) {
+        for (const auto [offset, length] : request->names) {
+          names.emplace_back(request->data.data() + offset, length);
+        }
+      }
+      if (records.size() < names.size()) records.resize(names.size());
+
+      pool_.run(names.size(), BatchOptions{}.chunk_size,
+                [&](const size_t worker, const size_t first, const size_t last) {
+                  auto& engine = engines_[worker];
+                  for (size_t i = first; i < last; ++i) {
+                    records[i].clear();
+                    write_record(format_, engine.parse(names[i], options_), records[i]);
+                  }
+                });
+
+      for (size_t i = 0; auto* request : batch) {
+        for (size_t j = 0; j < request->names.size(); ++j) {
+          request->response.append(records[i++]);
+        }
+        const auto size = static_cast<uint32_t>(request->response.size() - sizeof(uint32_t));
+        for (size_t j = 0; j < sizeof(uint32_t); ++j) {
+          request->response[j] = static_cast<char>((size >> (j * 8)) & 0xff);
+        }
+      }
+
+      {
+        std::lock_guard lock{mutex_};
+        for (auto* request : batch) request->done = true;
+      }
+      request_done_.notify_all();
+      batch.clear();
+    }
+  }
+
+  const Options options_;
+  const OutputFormat format_;
+  WorkerPool pool_;
+  std::vector<Engine> engines_;  // one for each worker
+
+  int listener_ = -1;
+  std::string path_;
+
+  std::mutex mutex_;
+  std::condition_variable_any request_ready_;
+  std::condition_variable request_done_;
+  std::vector<Request*> pending_;
+  bool stopped_ = false;
+};
+
+// Sends the names as a single request, and returns the response without its size
+inline std::optional<std::string> send_request(const int fd,
+                                               std::span<const std::string_view> names) {
+  std::string request;
+  write_binary_integer(static_cast<uint32_t>(names.size()), request);
+  for (const auto name : names) {
+    write_binary_string(name, request);
+  }
+  if (!write_all(fd, request)) return std::nullopt;
+
+  const auto size = read_u32(fd);
+  if (!size) return std::nullopt;
+  std::string response(*size, '\0');
+  if (!read_exact(fd, response.data(), response.size())) return std::nullopt;
+  return response;
+}
+
+}  // namespace anitomy::detail
+
+#endif
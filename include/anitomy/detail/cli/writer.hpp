@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace anitomy::detail {
+
+// Collects output in a large buffer and writes it to the file in as few calls as possible. Meant
+// for streaming a large number of results, where printing each one separately would dominate.
+class Writer final {
+public:
+  static constexpr size_t default_capacity = 1 << 20;
+
+  explicit Writer(std::FILE* file, size_t capacity = default_capacity) noexcept
+      : file_{file}, capacity_{capacity} {
+    buffer_.reserve(capacity_);
+  }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  ~Writer() {
+    flush();
+  }
+
+  inline void write(std::string_view output) noexcept {
+    if (buffer_.size() + output.size() > capacity_) flush();
+    if (output.size() >= capacity_) {
+      std::fwrite(output.data(), 1, output.size(), file_);
+    } else {
+      buffer_.append(output);
+    }
+  }
+
+  inline void write(char ch) noexcept {
+    if (buffer_.size() == capacity_) flush();
+    buffer_.push_back(ch);
+  }
+
+  inline void flush() noexcept {
+    if (!buffer_.empty()) {
+      std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+      buffer_.clear();
+    }
+    std::fflush(file_);
+  }
+
+private:
+  std::FILE* file_ = nullptr;
+  size_t capacity_ = 0;
+  std::string buffer_;
+};
+
+}  // namespace anitomy::detail
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <anitomy/detail/keyword.hpp>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+namespace anitomy::detail {
+
+enum class EntryKind {
+  Directory,
+  File,
+  Other,
+};
+
+// Calls `fn(name, kind)` for each entry in the directory, except for `.` and `..`. Returns false if
+// the directory cannot be read.
+//
+// On Linux, entries are read in batches with `getdents64`, which also provides their kind, so that
+// each entry does not need a separate `stat` call. Symbolic links are resolved only to find out
+// whether they point to a file, and links to directories are not followed, to avoid cycles.
+template <typename Fn>
+bool read_directory(const std::string& path, Fn&& fn) {
+#ifdef __linux__
+  struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+  };
+
+  const int dir = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir == -1) return false;
+
+  alignas(linux_dirent64) char buffer[1 << 16];
+
+  for (;;) {
+    const long size = ::syscall(SYS_getdents64, dir, buffer, sizeof(buffer));
+    if (size <= 0) {
+      ::close(dir);
+      return size == 0;
+    }
+
+    for (long offset = 0; offset < size;) {
+      const auto* entry = reinterpret_cast<const linux_dirent64*>(buffer + offset);
+      offset += entry->d_reclen;
+
+      const std::string_view name{entry->d_name};
+      if (name == "." || name == "..") continue;
+
+      EntryKind kind = EntryKind::Other;
+      switch (entry->d_type) {
+        case DT_DIR:
+          kind = EntryKind::Directory;
+          break;
+        case DT_REG:
+          kind = EntryKind::File;
+          break;
+        case DT_LNK:
+        case DT_UNKNOWN: {
+          // Some file systems do not provide the kind of entries, in which case links are found
+          // out here, and treated the same as when they are provided
+          struct stat status{};
+          bool is_link = entry->d_type == DT_LNK;
+          if (!is_link) {
+            if (::fstatat(dir, entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0) break;
+            is_link = S_ISLNK(status.st_mode);
+          }
+          if (is_link && ::fstatat(dir, entry->d_name, &status, 0) != 0) break;
+          if (S_ISREG(status.st_mode)) {
+            kind = EntryKind::File;
+          } else if (S_ISDIR(status.st_mode) && !is_link) {
+            kind = EntryKind::Directory;
+          }
+          break;
+        }
+      }
+
+      fn(name, kind);
+    }
+  }
+#else
+  // Paths are UTF-8 encoded
+  std::error_code error;
+  std::filesystem::directory_iterator it{std::u8string{path.begin(), path.end()}, error};
+  if (error) return false;
+
+  for (; it != std::filesystem::directory_iterator{}; it.increment(error)) {
+    if (error) return false;
+    const auto filename = it->path().filename().u8string();
+    const std::string name{filename.begin(), filename.end()};
+    if (it->is_symlink(error)) {
+      fn(name, it->is_regular_file(error) ? EntryKind::File : EntryKind::Other);
+    } else if (it->is_directory(error)) {
+      fn(name, EntryKind::Directory);
+    } else {
+      fn(name, it->is_regular_file(error) ? EntryKind::File : EntryKind::Other);
+    }
+  }
+  return !error;
+#endif
+}
+
+// Returns the paths of the files in the directory tree whose names satisfy the predicate, in
+// lexicographical order. Directories are read on `thread_count` threads (including the calling
+// thread). If a stop is requested, the files that were found until then are returned.
+//
+// Directories that cannot be read are skipped.
+template <typename Predicate>
+std::vector<std::string> find_files(const std::string& root, size_t thread_count,
+                                    const std::stop_token& stop_token, Predicate predicate) {
+  static constexpr auto join = [](const std::string& directory, std::string_view name) {
+    std::string path;
+    path.reserve(directory.size() + 1 + name.size());
+    path.append(directory);
+    if (!path.empty() && path.back() != '/') path.push_back('/');
+    path.append(name);
+    return path;
+  };
+
+  std::mutex mutex;
+  std::condition_variable_any condition;
+  std::vector<std::string> pending{root};
+  size_t active = 0;  // number of directories that are being read
+  std::vector<std::string> files;
+
+  // Workers take directories from a shared stack, and add the subdirectories that they find back
+  // to it. The walk is complete when the stack is empty and no directory is being read.
+  const auto work = [&] {
+    std::vector<std::string> found;
+    std::vector<std::string> subdirectories;
+
+    for (;;) {
+      std::string directory;
+      {
+        std::unique_lock lock{mutex};
+        condition.wait(lock, stop_token, [&] { return !pending.empty() || !active; });
+        if (pending.empty() || stop_token.stop_requested()) break;
+        directory = std::move(pending.back());
+        pending.pop_back();
+        ++active;
+      }
+
+      read_directory(directory, [&](std::string_view name, const EntryKind kind) {
+        if (kind == EntryKind::Directory) {
+          subdirectories.emplace_back(join(directory, name));
+        } else if (kind == EntryKind::File && predicate(name)) {
+          found.emplace_back(join(directory, name));
+        }
+      });
+
+      {
+        std::lock_guard lock{mutex};
+        std::ranges::move(subdirectories, std::back_inserter(pending));
+        --active;
+      }
+      subdirectories.clear();
+      condition.notify_all();
+    }
+
+    std::lock_guard lock{mutex};
+    std::ranges::move(found, std::back_inserter(files));
+    condition.notify_all();
+  };
+
+  if (!thread_count) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+      threads.emplace_back(work);
+    }
+    work();
+  }
+
+  std::ranges::sort(files);
+  return files;
+}
+
+// Returns the part of the path after the last separator.
+[[nodiscard]] constexpr std::string_view file_name(std::string_view path) noexcept {
+  const size_t slash = path.rfind('/');
+  return slash != std::string_view::npos ? path.substr(slash + 1) : path;
+}
+
+// Checks if the file name ends with a known video extension (e.g. `.mkv`).
+[[nodiscard]] constexpr bool has_video_extension(std::string_view name) noexcept {
+  const size_t dot = name.rfind('.');
+  if (dot == std::string_view::npos) return false;
+  const auto* keyword = keyword_trie.find(name.substr(dot + 1));
+  return keyword && keyword->kind == KeywordKind::FileExtension;
+}
+
+}  // namespace anitomy::detail
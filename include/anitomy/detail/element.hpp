@@ -1,32 +1,143 @@
 #pragma once
 
 #include <algorithm>
+#include <optional>
 #include <ranges>
-#include <set>
 #include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #include <anitomy/detail/delimiter.hpp>
 #include <anitomy/detail/token.hpp>
 #include <anitomy/detail/unicode.hpp>
+#include <anitomy/element.hpp>
+#include <anitomy/options.hpp>
 
 namespace anitomy::detail {
 
 enum class KeepDelimiters { No, Yes };
 
-inline std::string build_element_value(std::span<Token> tokens,
-                                       const KeepDelimiters keep_delimiters) noexcept {
+inline constexpr size_t element_kind_count = static_cast<size_t>(ElementKind::Year) + 1;
+
+// The string type of the elements in a container (e.g. `std::pmr::string` for `pmr::Element`)
+template <typename Elements>
+using element_string_t = Elements::value_type::string_type;
+
+// Appends an element, allocating its value with the allocator of the container
+template <typename Elements>
+constexpr void append_element(Elements& elements, const ElementKind kind,
+                              const std::string_view value, const size_t position) noexcept {
+  elements.emplace_back(kind, element_string_t<Elements>{value, elements.get_allocator()},
+                        position);
+}
+
+// Passes the elements of the requested kinds on to the container, and drops the rest without
+// allocating their values (values that are built from tokens are not built either, see
+// `is_requested`). Kinds that were found are remembered either way, as some stages depend on them.
+template <typename Elements>
+class ElementFilter final {
+public:
+  using value_type = Elements::value_type;
+
+  constexpr ElementFilter(Elements& elements, const ElementSet kinds) noexcept
+      : elements_{elements}, kinds_{kinds} {
+  }
+
+  template <typename... Args>
+  constexpr void emplace_back(const ElementKind kind, Args&&... args) noexcept {
+    found(kind);
+    if (kinds_.contains(kind)) elements_.emplace_back(kind, std::forward<Args>(args)...);
+  }
+
+  constexpr void append(const ElementKind kind, const std::string_view value,
+                        const size_t position) noexcept {
+    found(kind);
+    if (kinds_.contains(kind)) append_element(elements_, kind, value, position);
+  }
+
+  // Number of elements that were found, including the ones that were dropped
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    return size_;
+  }
+
+  // Returns true if an element of the kind was found, even if it was dropped
+  [[nodiscard]] constexpr bool contains(const ElementKind kind) const noexcept {
+    return found_.contains(kind);
+  }
+
+  // Returns true if elements of the kind are passed on, so that stages can skip building the values
+  // of the ones that are dropped
+  [[nodiscard]] constexpr bool is_requested(const ElementKind kind) const noexcept {
+    return kinds_.contains(kind);
+  }
+
+  [[nodiscard]] constexpr auto get_allocator() const noexcept {
+    return elements_.get_allocator();
+  }
+
+private:
+  constexpr void found(const ElementKind kind) noexcept {
+    found_.insert(kind);
+    ++size_;
+  }
+
+  Elements& elements_;
+  ElementSet kinds_;
+  ElementSet found_;
+  size_t size_ = 0;
+};
+
+template <typename Elements>
+constexpr void append_element(ElementFilter<Elements>& elements, const ElementKind kind,
+                              const std::string_view value, const size_t position) noexcept {
+  elements.append(kind, value, position);
+}
+
+template <typename Elements>
+[[nodiscard]] constexpr bool is_requested(const Elements&, const ElementKind) noexcept {
+  return true;
+}
+
+template <typename Elements>
+[[nodiscard]] constexpr bool is_requested(const ElementFilter<Elements>& elements,
+                                          const ElementKind kind) noexcept {
+  return elements.is_requested(kind);
+}
+
+// Returns the value of a keyword token, either as it appears in the input, or as it is spelled in
+// the keyword table
+template <typename ParseOptions = Options>
+constexpr std::string_view keyword_token_value(const Token& token,
+                                               const ParseOptions& options) noexcept {
+  return options.canonical_keywords ? keyword_value(*token.keyword) : token.value;
+}
+
+template <typename String = std::string>
+inline String build_element_value(std::span<Token> tokens, const KeepDelimiters keep_delimiters,
+                                  const typename String::allocator_type& allocator = {}) noexcept {
   static constexpr auto first_code_point = [](const Token& token) {
     return unicode::utf8::decode(token.value).code_point;
   };
 
-  const auto delimiters = tokens | std::views::filter(is_delimiter_token) |
-                          std::views::transform(first_code_point) |
-                          std::ranges::to<std::set<char32_t>>();
+  // Distinct delimiters are tracked without a container, as only a few facts about them matter
+  std::optional<char32_t> first_delimiter;
+  bool has_multiple_delimiters = false;
+  bool has_spaces = false;
+  bool has_underscores = false;
+
+  for (const auto& token : tokens | std::views::filter(is_delimiter_token)) {
+    const char32_t ch = first_code_point(token);
+    if (!first_delimiter) {
+      first_delimiter = ch;
+    } else if (*first_delimiter != ch) {
+      has_multiple_delimiters = true;
+    }
+    has_spaces = has_spaces || is_space(ch);
+    has_underscores = has_underscores || ch == U'_';
+  }
 
-  const bool has_single_delimiter = delimiters.size() == 1;
-  const bool has_spaces = std::ranges::any_of(delimiters, is_space);
-  const bool has_underscores = delimiters.contains(U'_');
+  const bool has_single_delimiter = first_delimiter && !has_multiple_delimiters;
 
   const auto is_transformable_delimiter = [&](const Token& token) {
     if (keep_delimiters == KeepDelimiters::Yes) return false;
@@ -47,7 +158,9 @@ inline std::string build_element_value(std::span<Token> tokens,
     }
   }
 
-  std::string element_value;
+  String element_value{allocator};
+  element_value.reserve(std::ranges::fold_left(
+      tokens, size_t{0}, [](size_t n, const Token& token) { return n + token.value.size(); }));
 
   for (const auto& token : tokens) {
     if (is_transformable_delimiter(token)) {
@@ -60,4 +173,30 @@ inline std::string build_element_value(std::span<Token> tokens,
   return element_value;
 }
 
+// Returns true if `build_element_value` would return an empty value, without building it
+[[nodiscard]] constexpr bool is_empty_element_value(std::span<const Token> tokens,
+                                                    const KeepDelimiters keep_delimiters) noexcept {
+  if (keep_delimiters == KeepDelimiters::No) {
+    while (!tokens.empty() && is_delimiter_token(tokens.back())) {
+      tokens = tokens.first(tokens.size() - 1);  // trim
+    }
+  }
+  return std::ranges::all_of(tokens, [](const Token& token) { return token.value.empty(); });
+}
+
+// Appends an element whose value is built from the tokens. The value is not built if the element
+// would be dropped.
+template <typename Elements>
+inline void append_element(Elements& elements, const ElementKind kind, std::span<Token> tokens,
+                           const KeepDelimiters keep_delimiters) noexcept {
+  const size_t position = tokens.front().position;
+  if (!is_requested(elements, kind)) {
+    append_element(elements, kind, std::string_view{}, position);
+    return;
+  }
+  auto value = build_element_value<element_string_t<Elements>>(tokens, keep_delimiters,
+                                                               elements.get_allocator());
+  elements.emplace_back(kind, std::move(value), position);
+}
+
 }  // namespace anitomy::detail
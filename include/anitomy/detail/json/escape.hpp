@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+namespace anitomy::detail::json {
+
+// Maps each byte to the character that follows the backslash in its escape sequence, or to zero if
+// it can be written as is. Control characters without a short form are written as `\u00XX`.
+inline constexpr auto escape_table = [] {
+  std::array<char, 256> table{};
+  for (size_t ch = 0; ch < 0x20; ++ch) table[ch] = 'u';
+  table['"'] = '"';
+  table['\\'] = '\\';
+  table['\b'] = 'b';
+  table['\f'] = 'f';
+  table['\n'] = 'n';
+  table['\r'] = 'r';
+  table['\t'] = 't';
+  return table;
+}();
+
+// Appends the string with the characters that are reserved in JSON escaped. Runs of characters that
+// do not need to be escaped are appended at once.
+inline void append_escaped(std::string_view input, std::string& output) {
+  static constexpr std::string_view hex_digits{"0123456789abcdef"};
+
+  size_t first = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    const char escape = escape_table[static_cast<unsigned char>(input[i])];
+    if (!escape) continue;
+    output.append(input.substr(first, i - first));
+    output.push_back('\\');
+    output.push_back(escape);
+    if (escape == 'u') {
+      const auto ch = static_cast<unsigned char>(input[i]);
+      output.append("00");
+      output.push_back(hex_digits[ch >> 4]);
+      output.push_back(hex_digits[ch & 0xf]);
+    }
+    first = i + 1;
+  }
+  output.append(input.substr(first));
+}
+
+}  // namespace anitomy::detail::json
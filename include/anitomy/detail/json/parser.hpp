@@ -38,7 +38,7 @@ private:
   }
 
   [[nodiscard]] inline expected_t<value_t> parse_value() noexcept {
-    static const auto parse = [this]() -> expected_t<value_t> {
+    const auto parse = [this]() -> expected_t<value_t> {
       if (view_.empty()) {
         return object_t{};
       }
@@ -129,7 +129,7 @@ private:
   }
 
   [[nodiscard]] inline expected_t<string_t> parse_string() noexcept {
-    static const std::function<string_t()> parse = [this]() {
+    const std::function<string_t()> parse = [this, &parse]() {
       constexpr auto is_string = [](const char ch) { return ch != '"'; };
       auto view = view_ | std::views::take_while(is_string);
       auto string = take(std::ranges::distance(view));
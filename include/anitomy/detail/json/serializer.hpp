@@ -1,9 +1,9 @@
 #pragma once
 
 #include <format>
-#include <regex>
 #include <string>
 
+#include <anitomy/detail/json/escape.hpp>
 #include <anitomy/detail/json/value.hpp>
 
 namespace anitomy::detail::json {
@@ -106,7 +106,9 @@ private:
   }
 
   static inline void serialize_string(const string_t& value, std::string& output) noexcept {
-    output.append(std::format(R"("{}")", escape_string(value)));
+    output.push_back('"');
+    append_escaped(value, output);
+    output.push_back('"');
   }
 
   static inline void serialize_integer(const int value, std::string& output) noexcept {
@@ -129,11 +131,6 @@ private:
     output.append(std::format("{:<{}}", "", indentation_ * 2));
   }
 
-  [[nodiscard]] static inline std::string escape_string(std::string input) noexcept {
-    static const std::regex reserved{R"(["\\])"};
-    return std::regex_replace(input, reserved, R"(\$&)");
-  };
-
   int indentation_ = 0;
   bool pretty_ = false;
   Value value_;
@@ -1,11 +1,11 @@
 #pragma once
 
-#include <algorithm>
-#include <ranges>
-#include <string>
+#include <array>
+#include <cstdint>
 #include <string_view>
-#include <unordered_map>
+#include <utility>
 
+#include <anitomy/detail/profile.hpp>
 #include <anitomy/detail/util.hpp>
 
 namespace anitomy::detail {
@@ -45,6 +45,7 @@ struct Keyword {
 
   KeywordKind kind;
   uint8_t flags = 0;
+  uint16_t id = 0;  // index in `keywords`
 
   constexpr bool is_ambiguous() const noexcept {
     return (flags & Ambiguous) == Ambiguous;
@@ -55,27 +56,13 @@ struct Keyword {
   }
 };
 
-struct KeywordHash {
-  [[nodiscard]] size_t operator()(std::string_view view) const noexcept {
-    auto str = view | std::views::transform(to_lower<char>) | std::ranges::to<std::string>();
-    return std::hash<std::string>()(str);
-  }
-};
-
-struct KeywordEqual {
-  [[nodiscard]] bool operator()(std::string_view a, std::string_view b) const noexcept {
-    return std::ranges::equal(a, b, equal_to);
-  }
-};
-
-using keyword_map_t = std::unordered_map<std::string_view, Keyword, KeywordHash, KeywordEqual>;
-
-inline auto keywords = []() -> keyword_map_t {
+inline constexpr auto keywords = []() {
   using enum KeywordKind;
   using enum Keyword::Flags;
+  using keyword_t = std::pair<std::string_view, Keyword>;
 
   // clang-format off
-  return {
+  auto keywords = std::to_array<keyword_t>({
       // Audio
       //
       // Channels
@@ -338,8 +325,104 @@ inline auto keywords = []() -> keyword_map_t {
       // Volume
       {"Vol",                  {Volume, 0}},
       {"Volume",               {Volume, 0}},
-  };
+  });
   // clang-format on
+
+  for (size_t i = 0; i < keywords.size(); ++i) {
+    keywords[i].second.id = static_cast<uint16_t>(i);
+  }
+
+  return keywords;
 }();
 
+// Keywords are compiled into a case-insensitive trie, so that the tokenizer can find the longest
+// matching keyword in a single forward pass. In case of duplicates, the first keyword wins.
+class KeywordTrie final {
+public:
+  struct Node {
+    unsigned char ch = 0;
+    uint16_t child = 0;    // index of the first child (children are sorted by `ch`)
+    uint16_t sibling = 0;  // index of the next sibling
+    int16_t keyword = -1;  // index in `keywords`
+  };
+
+  consteval KeywordTrie() noexcept {
+    for (size_t i = 0; i < keywords.size(); ++i) {
+      insert(keywords[i].first, static_cast<int16_t>(i));
+    }
+  }
+
+  [[nodiscard]] constexpr const Node* root() const noexcept {
+    return &nodes_.front();
+  }
+
+  [[nodiscard]] constexpr const Node* next(const Node* node, const char ch) const noexcept {
+    ANITOMY_PROFILE_COUNT(KeywordProbes);
+    const auto byte = static_cast<unsigned char>(to_lower(ch));
+    for (auto i = node->child; i != 0; i = nodes_[i].sibling) {
+      if (nodes_[i].ch == byte) return &nodes_[i];
+      if (nodes_[i].ch > byte) break;
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] constexpr const Keyword* keyword(const Node* node) const noexcept {
+    return node && node->keyword >= 0 ? &keywords[node->keyword].second : nullptr;
+  }
+
+  [[nodiscard]] constexpr const Keyword* find(std::string_view key) const noexcept {
+    const Node* node = root();
+    for (auto it = key.begin(); node && it != key.end(); ++it) {
+      node = next(node, *it);
+    }
+    return keyword(node);
+  }
+
+private:
+  consteval void insert(std::string_view key, const int16_t keyword) noexcept {
+    uint16_t node = 0;
+    for (const char ch : key) {
+      const auto byte = static_cast<unsigned char>(to_lower(ch));
+      uint16_t* link = &nodes_[node].child;
+      while (*link != 0 && nodes_[*link].ch < byte) {
+        link = &nodes_[*link].sibling;
+      }
+      if (*link == 0 || nodes_[*link].ch != byte) {
+        nodes_[size_] = {.ch = byte, .sibling = *link};
+        *link = static_cast<uint16_t>(size_++);
+      }
+      node = *link;
+    }
+    if (nodes_[node].keyword < 0) nodes_[node].keyword = keyword;
+  }
+
+  static constexpr size_t capacity = [] {
+    size_t size = 1;  // root
+    for (const auto& [key, _] : keywords) size += key.size();
+    return size;
+  }();
+
+  std::array<Node, capacity> nodes_{};
+  size_t size_ = 1;
+};
+
+inline constexpr KeywordTrie keyword_trie;
+
+// Changes whenever a keyword is added, removed or changed, so that persisted results can be
+// invalidated
+inline constexpr uint64_t keyword_table_hash = [] {
+  uint64_t hash = hash_bytes({});
+  for (const auto& [key, keyword] : keywords) {
+    const char fields[] = {static_cast<char>(keyword.kind), static_cast<char>(keyword.flags), 0};
+    hash = hash_bytes(key, hash);
+    hash = hash_bytes({fields, sizeof(fields)}, hash);
+  }
+  return hash;
+}();
+
+// Returns the keyword as it is spelled in the table, which is the same for all of its matches
+[[nodiscard]] constexpr std::string_view keyword_value(const Keyword& keyword) noexcept {
+  return keywords[keyword.id].first;
+}
+
 }  // namespace anitomy::detail
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace anitomy::detail {
+
+// Maps a file into memory as read-only, so that its contents can be viewed without being copied.
+// Unlike `read_file`, this works for files that are larger than the available memory.
+class MappedFile final {
+public:
+  MappedFile() noexcept = default;
+
+  explicit MappedFile(const std::string& path) noexcept {
+    open(path);
+  }
+
+  MappedFile(MappedFile&& other) noexcept
+      : data_{std::exchange(other.data_, nullptr)},
+        size_{std::exchange(other.size_, 0)},
+        is_open_{std::exchange(other.is_open_, false)} {
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      is_open_ = std::exchange(other.is_open_, false);
+    }
+    return *this;
+  }
+
+  ~MappedFile() {
+    close();
+  }
+
+  // Empty files cannot be mapped, but they are opened successfully with an empty view.
+  inline bool open(const std::string& path) noexcept {
+    close();
+    size_t size = 0;
+
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size{};
+    bool success = GetFileSizeEx(file, &file_size) != 0;
+    size = success ? static_cast<size_t>(file_size.QuadPart) : 0;
+    if (size > 0) {
+      if (const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+        data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+      }
+      success = data_ != nullptr;
+    }
+    CloseHandle(file);
+    if (!success) return false;
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file == -1) return false;
+
+    struct stat status{};
+    bool success = ::fstat(file, &status) == 0;
+    size = success ? static_cast<size_t>(status.st_size) : 0;
+    if (size > 0) {
+      void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+      success = data != MAP_FAILED;
+      if (success) {
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(data);
+      }
+    }
+    ::close(file);
+    if (!success) return false;
+#endif
+
+    size_ = data_ ? size : 0;
+    is_open_ = true;
+    return true;
+  }
+
+  inline void close() noexcept {
+    if (data_) {
+#ifdef _WIN32
+      UnmapViewOfFile(data_);
+#else
+      ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    is_open_ = false;
+  }
+
+  [[nodiscard]] constexpr bool is_open() const noexcept {
+    return is_open_;
+  }
+
+  // The view is valid until the file is closed.
+  [[nodiscard]] constexpr std::string_view view() const noexcept {
+    return data_ ? std::string_view{data_, size_} : std::string_view{};
+  }
+
+private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool is_open_ = false;
+};
+
+}  // namespace anitomy::detail
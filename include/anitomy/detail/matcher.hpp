@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string_view>
+
+#ifdef ANITOMY_USE_REGEX
+#include <regex>
+#endif
+
+#include <anitomy/detail/profile.hpp>
+#include <anitomy/detail/util.hpp>
+
+// Patterns that are used to identify elements within a single token.
+//
+// Each pattern is matched against the whole token, and its capturing groups are returned as
+// slices of the input. Optional groups that did not participate in the match are left empty.
+//
+// The reference implementation uses `std::regex`, which is notoriously slow and allocates on every
+// match. By default, hand-written matchers are used instead. Define `ANITOMY_USE_REGEX` to switch
+// back to the regular expressions (e.g. for differential testing).
+
+namespace anitomy::detail {
+
+template <size_t N>
+using match_t = std::optional<std::array<std::string_view, N>>;
+
+class Matcher final {
+public:
+  constexpr explicit Matcher(std::string_view input) noexcept : view_{input} {
+    ANITOMY_PROFILE_COUNT(MatcherCalls);
+  }
+
+  [[nodiscard]] constexpr bool is_eof() const noexcept {
+    return view_.empty();
+  }
+
+  [[nodiscard]] constexpr char peek(const size_t offset = 0) const noexcept {
+    return offset < view_.size() ? view_[offset] : '\0';
+  }
+
+  constexpr void skip(const size_t n = 1) noexcept {
+    view_.remove_prefix(std::min(n, view_.size()));
+  }
+
+  constexpr bool skip(const char ch) noexcept {
+    if (!view_.starts_with(ch)) return false;
+    view_.remove_prefix(1);
+    return true;
+  }
+
+  constexpr bool skip(const std::string_view str) noexcept {
+    if (!view_.starts_with(str)) return false;
+    view_.remove_prefix(str.size());
+    return true;
+  }
+
+  // Greedily takes up to `max` digits. Nothing is taken if there are fewer than `min` digits.
+  [[nodiscard]] constexpr std::string_view take_digits(const size_t min,
+                                                       const size_t max) noexcept {
+    size_t n = 0;
+    while (n < max && is_digit(peek(n))) ++n;
+    if (n < min) return {};
+    const auto digits = view_.substr(0, n);
+    view_.remove_prefix(n);
+    return digits;
+  }
+
+  // `(?:[vV](\d))?`
+  [[nodiscard]] constexpr std::string_view take_version() noexcept {
+    if ((peek() != 'v' && peek() != 'V') || !is_digit(peek(1))) return {};
+    skip();
+    return take_digits(1, 1);
+  }
+
+private:
+  std::string_view view_;
+};
+
+#ifdef ANITOMY_USE_REGEX
+template <size_t N>
+[[nodiscard]] inline match_t<N> regex_match(std::string_view input,
+                                            const std::regex& pattern) noexcept {
+  std::match_results<std::string_view::const_iterator> matches;
+  if (!std::regex_match(input.begin(), input.end(), matches, pattern)) return std::nullopt;
+  std::array<std::string_view, N> groups;
+  for (size_t i = 0; i < N; ++i) {
+    if (matches[i + 1].matched) {
+      groups[i] = input.substr(matches.position(i + 1), matches.length(i + 1));
+    }
+  }
+  return groups;
+}
+#endif
+
+// Episode prefix (e.g. `E1`, `EP1`, `Eps1v2`)
+[[nodiscard]] inline match_t<2> match_episode_prefix(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{R"((?:E|E[Pp]|Eps)(\d{1,4})(?:[vV](\d))?)"};
+  return regex_match<2>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 2> groups;
+  if (!m.skip('E')) return std::nullopt;
+  if (!m.skip("ps") && !m.skip('p')) m.skip('P');
+  if ((groups[0] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  groups[1] = m.take_version();
+  if (!m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Single episode (e.g. `01v2`)
+[[nodiscard]] inline match_t<2> match_single_episode(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{R"((\d{1,4})[vV](\d))"};
+  return regex_match<2>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 2> groups;
+  if ((groups[0] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  if ((groups[1] = m.take_version()).empty()) return std::nullopt;
+  if (!m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Multi episode (e.g. `01-02`, `03-05v2`)
+[[nodiscard]] inline match_t<4> match_multi_episode(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{R"((\d{1,4})(?:[vV](\d))?[-~&+])"
+                                  R"((\d{1,4})(?:[vV](\d))?)"};
+  return regex_match<4>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 4> groups;
+  if ((groups[0] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  groups[1] = m.take_version();
+  if (!std::string_view{"-~&+"}.contains(m.peek())) return std::nullopt;
+  m.skip();
+  if ((groups[2] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  groups[3] = m.take_version();
+  if (!m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Season and episode (e.g. `2x01`, `S01E03`, `S01-02xE001-150`)
+[[nodiscard]] inline match_t<5> match_season_and_episode(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{
+      "S?"
+      "(\\d{1,2})(?:-S?(\\d{1,2}))?"
+      "(?:x|[ ._-x]?E)"
+      "(\\d{1,4})(?:-E?(\\d{1,4}))?"
+      "(?:[vV](\\d))?"};
+  return regex_match<5>(input, pattern);
+#else
+  // Note that `_-x` is a range in the reference pattern
+  static constexpr auto is_separator = [](const char ch) {
+    return ch == ' ' || ch == '.' || ('_' <= ch && ch <= 'x');
+  };
+
+  Matcher m{input};
+  std::array<std::string_view, 5> groups;
+  m.skip('S');
+  if ((groups[0] = m.take_digits(1, 2)).empty()) return std::nullopt;
+  if (m.skip('-')) {
+    m.skip('S');
+    if ((groups[1] = m.take_digits(1, 2)).empty()) return std::nullopt;
+  }
+  if (m.peek() == 'x' && is_digit(m.peek(1))) {
+    m.skip();
+  } else {
+    if (is_separator(m.peek()) && m.peek(1) == 'E') m.skip();
+    if (!m.skip('E')) return std::nullopt;
+  }
+  if ((groups[2] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  if (m.skip('-')) {
+    m.skip('E');
+    if ((groups[3] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  }
+  groups[4] = m.take_version();
+  if (!m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Number sign (e.g. `#01`, `#02-03v2`)
+[[nodiscard]] inline match_t<3> match_number_sign(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{"#(\\d{1,4})(?:[-~&+](\\d{1,4}))?(?:[vV](\\d))?"};
+  return regex_match<3>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 3> groups;
+  if (!m.skip('#')) return std::nullopt;
+  if ((groups[0] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  if (std::string_view{"-~&+"}.contains(m.peek())) {
+    m.skip();
+    if ((groups[1] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  }
+  groups[2] = m.take_version();
+  if (!m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Japanese counter for episodes (e.g. `第01話`)
+[[nodiscard]] inline match_t<1> match_japanese_episode(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{"(?:第)?(\\d{1,4})話"};
+  return regex_match<1>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 1> groups;
+  m.skip("第");
+  if ((groups[0] = m.take_digits(1, 4)).empty()) return std::nullopt;
+  if (!m.skip("話") || !m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Partial episode (e.g. `4a`, `111C`)
+[[nodiscard]] inline bool is_partial_episode(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{R"(\d{1,4}[ABCabc])"};
+  return regex_match<0>(input, pattern).has_value();
+#else
+  Matcher m{input};
+  if (m.take_digits(1, 4).empty()) return false;
+  if (!std::string_view{"ABCabc"}.contains(m.peek())) return false;
+  m.skip();
+  return m.is_eof();
+#endif
+}
+
+// Season (e.g. `S2`)
+[[nodiscard]] inline match_t<1> match_season(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{"S(\\d{1,2})"};
+  return regex_match<1>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 1> groups;
+  if (!m.skip('S')) return std::nullopt;
+  if ((groups[0] = m.take_digits(1, 2)).empty()) return std::nullopt;
+  if (!m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Japanese counter for seasons (e.g. `第2期`)
+[[nodiscard]] inline match_t<1> match_japanese_season(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{"(?:第)?(\\d{1,2})期"};
+  return regex_match<1>(input, pattern);
+#else
+  Matcher m{input};
+  std::array<std::string_view, 1> groups;
+  m.skip("第");
+  if ((groups[0] = m.take_digits(1, 2)).empty()) return std::nullopt;
+  if (!m.skip("期") || !m.is_eof()) return std::nullopt;
+  return groups;
+#endif
+}
+
+// Video resolution (e.g. `1080p`, `1920x1080`, `1280×720`)
+[[nodiscard]] inline bool is_video_resolution(std::string_view input) noexcept {
+#ifdef ANITOMY_USE_REGEX
+  static const std::regex pattern{R"(\d{3,4}(?:[ip]|(?:[xX]|×)\d{3,4}[ip]?))"};
+  return regex_match<0>(input, pattern).has_value();
+#else
+  Matcher m{input};
+  if (m.take_digits(3, 4).empty()) return false;
+  if (m.peek() == 'i' || m.peek() == 'p') {
+    m.skip();
+    return m.is_eof();
+  }
+  if (!m.skip('x') && !m.skip('X') && !m.skip("×")) return false;
+  if (m.take_digits(3, 4).empty()) return false;
+  if (m.peek() == 'i' || m.peek() == 'p') m.skip();
+  return m.is_eof();
+#endif
+}
+
+}  // namespace anitomy::detail
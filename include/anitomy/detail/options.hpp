@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include <anitomy/options.hpp>
+
+namespace anitomy::detail {
+
+// Identifies the options that affect the result. Update this when adding a new option.
+[[nodiscard]] constexpr uint32_t fingerprint(const Options& options) noexcept {
+  static_assert(sizeof(Options) == 16, "Options have changed");
+  static_assert(static_cast<size_t>(ElementKind::Year) < 22, "Element kinds do not fit");
+  uint32_t bits = 0;
+  for (const bool option : {
+           options.parse_episode,
+           options.parse_episode_title,
+           options.parse_file_checksum,
+           options.parse_file_extension,
+           options.parse_release_group,
+           options.parse_season,
+           options.parse_title,
+           options.parse_video_resolution,
+           options.parse_year,
+           options.canonical_keywords,
+       }) {
+    bits = (bits << 1) | option;
+  }
+  return (bits << 22) | options.kinds.bits;
+}
+
+// Options that are known at compile time. The parser takes these in place of `Options`, so that
+// the stages that they disable (along with their tables) are not compiled at all, regardless of
+// optimization. Update this when adding a new option.
+template <Options options>
+struct StaticOptions {
+  static_assert(sizeof(Options) == 16, "Options have changed");
+  static constexpr bool parse_episode = options.parse_episode;
+  static constexpr bool parse_episode_title = options.parse_episode_title;
+  static constexpr bool parse_file_checksum = options.parse_file_checksum;
+  static constexpr bool parse_file_extension = options.parse_file_extension;
+  static constexpr bool parse_release_group = options.parse_release_group;
+  static constexpr bool parse_season = options.parse_season;
+  static constexpr bool parse_title = options.parse_title;
+  static constexpr bool parse_video_resolution = options.parse_video_resolution;
+  static constexpr bool parse_year = options.parse_year;
+  static constexpr bool canonical_keywords = options.canonical_keywords;
+  static constexpr ElementSet kinds = options.kinds;
+};
+
+template <typename T>
+inline constexpr bool is_static_options_v = false;
+
+template <Options options>
+inline constexpr bool is_static_options_v<StaticOptions<options>> = true;
+
+}  // namespace anitomy::detail
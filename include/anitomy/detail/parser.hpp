@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -15,15 +17,93 @@
 #include <anitomy/detail/parser/video_resolution.hpp>
 #include <anitomy/detail/parser/volume.hpp>
 #include <anitomy/detail/parser/year.hpp>
+#include <anitomy/detail/element.hpp>
+#include <anitomy/detail/options.hpp>
+#include <anitomy/detail/profile.hpp>
 #include <anitomy/detail/token.hpp>
+#include <anitomy/detail/token_index.hpp>
+#include <anitomy/detail/util.hpp>
 #include <anitomy/element.hpp>
 #include <anitomy/options.hpp>
 
 namespace anitomy::detail {
 
+// Stages of the parser, in the order that they run
+enum class ParserStage {
+  FileExtension,
+  Keywords,
+  FileChecksum,
+  VideoResolution,
+  Year,
+  Season,
+  Episode,  // including volume
+  Title,
+  ReleaseGroup,
+  EpisodeTitle,
+};
+
+// Returns the last stage that can find elements of the given kinds. Each stage only looks at the
+// tokens that the stages before it have not identified, so it depends on all of them, but the
+// stages after it can be skipped.
+[[nodiscard]] constexpr std::optional<ParserStage> last_stage(const ElementSet kinds) noexcept {
+  using enum ElementKind;
+  // clang-format off
+  if (kinds.contains(EpisodeTitle)) return ParserStage::EpisodeTitle;
+  if (kinds.contains(ReleaseGroup)) return ParserStage::ReleaseGroup;
+  if (kinds.contains(Title)) return ParserStage::Title;
+  if (kinds.contains(Episode) || kinds.contains(Volume)) return ParserStage::Episode;
+  if (kinds.contains(ReleaseVersion) || kinds.contains(Season)) return ParserStage::Episode;
+  if (kinds.contains(Year)) return ParserStage::Year;
+  if (kinds.contains(VideoResolution)) return ParserStage::VideoResolution;
+  if (kinds.contains(FileChecksum)) return ParserStage::FileChecksum;
+  if (kinds.empty()) return std::nullopt;
+  if (kinds == ElementSet{FileExtension}) return ParserStage::FileExtension;
+  // clang-format on
+  return ParserStage::Keywords;  // all other kinds come from keywords
+}
+
+// Returns false if the options disable the stage
+template <typename ParseOptions>
+[[nodiscard]] constexpr bool is_stage_enabled(const ParserStage stage,
+                                              const ParseOptions& options) noexcept {
+  using enum ParserStage;
+  // clang-format off
+  switch (stage) {
+    case FileExtension: return options.parse_file_extension;
+    case Keywords: return true;
+    case FileChecksum: return options.parse_file_checksum;
+    case VideoResolution: return options.parse_video_resolution;
+    case Year: return options.parse_year;
+    case Season: return options.parse_season;
+    case Episode: return options.parse_episode;
+    case Title: return options.parse_title;
+    case ReleaseGroup: return options.parse_release_group;
+    case EpisodeTitle: return options.parse_episode_title;
+  }
+  // clang-format on
+  return true;
+}
+
+template <typename Allocator = std::allocator<char>>
 class Parser final {
 public:
-  explicit Parser(std::vector<Token>& tokens) : tokens_{std::move(tokens)} {
+  using element_type = BasicElement<Allocator>;
+  using elements_type = std::vector<element_type, rebind_alloc_t<Allocator, element_type>>;
+  using tokens_type = std::vector<Token, rebind_alloc_t<Allocator, Token>>;
+
+  Parser() noexcept = default;
+
+  explicit Parser(tokens_type& tokens)
+      : elements_{tokens.get_allocator()},
+        index_{tokens.get_allocator()},
+        tokens_{std::move(tokens)} {
+  }
+
+  // Takes over the tokens, and gives back the previous ones so that their capacity can be reused.
+  // Elements of the previous input are discarded.
+  inline void reset(tokens_type& tokens) noexcept {
+    tokens_.swap(tokens);
+    elements_.clear();
   }
 
   [[nodiscard]] constexpr auto&& elements(this auto&& self) noexcept {
@@ -34,79 +114,109 @@ public:
     return std::forward<decltype(self)>(self).tokens_;
   }
 
-  inline void parse(const Options& options) noexcept {
-    // File extension
-    if (options.parse_file_extension) {
-      add_element(parse_file_extension(tokens_));
+  // The options are either `Options`, or `StaticOptions` to decide which stages run at compile time
+  template <typename ParseOptions = Options>
+  inline void parse(const ParseOptions& options) noexcept {
+    using enum ParserStage;
+
+    const auto last = last_stage(options.kinds);
+    if (!last) return;
+
+    ElementFilter elements{elements_, options.kinds};
+
+    if (*last >= Year) {
+      ANITOMY_PROFILE_SCOPE(Index);
+      index_.build(tokens_);
     }
 
+    // File extension
+    run_stage<FileExtension>(options, *last, elements, [&](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(FileExtension);
+      parse_file_extension(tokens_, options, elements);
+    });
+
     // Keywords
-    add_elements(parse_keywords(tokens_, options));
+    run_stage<Keywords>(options, *last, elements, [&](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(Keywords);
+      parse_keywords(tokens_, options, elements);
+    });
 
     // Checksum
-    if (options.parse_file_checksum) {
-      add_element(parse_file_checksum(tokens_));
-    }
+    run_stage<FileChecksum>(options, *last, elements, [this](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(FileChecksum);
+      parse_file_checksum(tokens_, elements);
+    });
 
     // Video resolution
-    if (options.parse_video_resolution) {
-      add_elements(parse_video_resolution(tokens_));
-    }
+    run_stage<VideoResolution>(options, *last, elements, [this](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(VideoResolution);
+      parse_video_resolution(tokens_, elements);
+    });
 
     // Year
-    if (options.parse_year) {
-      add_element(parse_year(tokens_));
-    }
+    run_stage<Year>(options, *last, elements, [this](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(Year);
+      parse_year(tokens_, index_, elements);
+    });
 
     // Season
-    if (options.parse_season) {
-      add_element(parse_season(tokens_));
-    }
+    run_stage<Season>(options, *last, elements, [this](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(Season);
+      parse_season(tokens_, index_, elements);
+    });
 
     // Episode
-    if (options.parse_episode) {
-      add_element(parse_volume(tokens_));
-      add_elements(parse_episode(tokens_));
-    }
+    run_stage<Episode>(options, *last, elements, [this](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(Episode);
+      parse_volume(tokens_, index_, elements);
+      parse_episode(tokens_, index_, elements);
+    });
 
     // Title
-    if (options.parse_title) {
-      add_element(parse_title(tokens_));
-    }
+    run_stage<Title>(options, *last, elements, [this](auto& elements) {
+      ANITOMY_PROFILE_SCOPE(Title);
+      parse_title(tokens_, index_, elements);
+    });
 
     // Release group
-    if (options.parse_release_group && !contains(ElementKind::ReleaseGroup)) {
-      add_element(parse_release_group(tokens_));
-    }
+    run_stage<ReleaseGroup>(options, *last, elements, [this](auto& elements) {
+      if (elements.contains(ElementKind::ReleaseGroup)) return;
+      ANITOMY_PROFILE_SCOPE(ReleaseGroup);
+      parse_release_group(tokens_, index_, elements);
+    });
 
     // Episode title
-    if (options.parse_episode_title && contains(ElementKind::Episode)) {
-      add_element(parse_episode_title(tokens_));
-    }
-
-    std::ranges::sort(elements_, {}, &Element::position);
+    run_stage<EpisodeTitle>(options, *last, elements, [this](auto& elements) {
+      if (!elements.contains(ElementKind::Episode)) return;
+      ANITOMY_PROFILE_SCOPE(EpisodeTitle);
+      parse_episode_title(tokens_, elements);
+    });
+
+    ANITOMY_PROFILE_SCOPE(Sort);
+    std::ranges::sort(elements_, {}, &element_type::position);
   }
 
 private:
-  constexpr void add_element(std::optional<Element>&& element) noexcept {
-    if (element) {
-      elements_.emplace_back(*element);
+  // Calls `fn(elements)` if the stage is not after the last one, and the options do not disable it.
+  // With `StaticOptions`, this is decided at compile time, and `fn` is not even instantiated for
+  // stages that do not run, as it is a generic lambda.
+  template <ParserStage stage, typename ParseOptions, typename Elements, typename Fn>
+  static constexpr void run_stage(const ParseOptions& options, const ParserStage last,
+                                  Elements& elements, Fn&& fn) noexcept {
+    if constexpr (is_static_options_v<ParseOptions>) {
+      constexpr auto static_last = last_stage(ParseOptions::kinds);
+      if constexpr (static_last && stage <= *static_last &&
+                    is_stage_enabled(stage, ParseOptions{})) {
+        fn(elements);
+      }
+    } else {
+      if (stage <= last && is_stage_enabled(stage, options)) fn(elements);
     }
   }
 
-  constexpr void add_elements(std::vector<Element>&& elements) noexcept {
-    if (!elements.empty()) {
-      std::ranges::move(elements, std::back_inserter(elements_));
-    }
-  }
-
-  [[nodiscard]] bool contains(ElementKind kind) const noexcept {
-    const auto is_kind = [&kind](const Element& element) { return element.kind == kind; };
-    return std::ranges::any_of(elements_, is_kind);
-  }
-
-  std::vector<Element> elements_;
-  std::vector<Token> tokens_;
+  elements_type elements_;
+  TokenIndex<Allocator> index_;
+  tokens_type tokens_;
 };
 
 }  // namespace anitomy::detail
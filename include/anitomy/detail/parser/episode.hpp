@@ -1,219 +1,179 @@
 #pragma once
 
 #include <ranges>
-#include <regex>
 #include <span>
-#include <vector>
+#include <string>
+#include <string_view>
 
 #include <anitomy/detail/container.hpp>
 #include <anitomy/detail/delimiter.hpp>
+#include <anitomy/detail/element.hpp>
+#include <anitomy/detail/matcher.hpp>
 #include <anitomy/detail/token.hpp>
+#include <anitomy/detail/token_index.hpp>
 #include <anitomy/detail/util.hpp>
 #include <anitomy/element.hpp>
 
 namespace anitomy::detail {
 
-inline std::vector<Element> parse_episode(std::span<Token> tokens) noexcept {
+template <typename Elements, typename Allocator>
+inline void parse_episode(std::span<Token> tokens, const TokenIndex<Allocator>& index,
+                          Elements& elements) noexcept {
   using namespace std::views;
 
-  std::vector<Element> elements;
-
-  static const auto add_element = [&elements](ElementKind kind, std::string_view value,
-                                              size_t position) {
-    elements.emplace_back(kind, std::string{value}, position);
+  const auto add_element = [&elements](ElementKind kind, std::string_view value,
+                                       size_t position) {
+    append_element(elements, kind, value, position);
   };
 
-  static const auto add_element_from_token = [&elements](ElementKind kind, Token& token,
-                                                         std::string_view value = {},
-                                                         size_t position = std::string::npos) {
+  const auto add_element_from_token = [&elements](ElementKind kind, Token& token,
+                                                  std::string_view value = {},
+                                                  size_t position = std::string::npos) {
     token.element_kind = kind;
-    elements.emplace_back(kind, value.empty() ? token.value : std::string{value},
-                          position != std::string::npos ? position : token.position);
+    append_element(elements, kind, value.empty() ? token.value : value,
+                   position != std::string::npos ? position : token.position);
   };
 
-  // Episode prefix (e.g. `E1`, `EP1`, `Episode 1`)
-  {
-    static constexpr auto is_episode_keyword = [](const Token& token) {
-      return token.keyword && token.keyword->kind == KeywordKind::Episode;
-    };
+  // Returns the first free numeric token after the first keyword of the given kind
+  const auto find_number_after_keyword = [&tokens, &index](KeywordKind kind) -> Token* {
+    const auto keywords = index.keywords(kind);
+    if (keywords.empty()) return nullptr;
+    const size_t i = index.next_non_delimiter(keywords.front());
+    if (i == tokens.size()) return nullptr;
+    if (!is_free_token(tokens[i]) || !is_numeric_token(tokens[i])) return nullptr;
+    return &tokens[i];
+  };
 
-    auto episode_token = std::ranges::find_if(tokens, is_episode_keyword);
+  // Indices of free numeric tokens
+  const auto free_numbers = [&tokens, &index]() {
+    return index.numbers() | filter([&tokens](const size_t i) { return is_free_token(tokens[i]); });
+  };
 
+  // Episode prefix (e.g. `E1`, `EP1`, `Episode 1`)
+  {
     // Check next token for a number
-    if (auto token = find_next_token(tokens, episode_token, is_not_delimiter_token);
-        token != tokens.end()) {
-      if (is_free_token(*token) && is_numeric_token(*token)) {
-        add_element_from_token(ElementKind::Episode, *token);
-        episode_token->element_kind = ElementKind::Episode;
-        return elements;
-      }
+    if (auto token = find_number_after_keyword(KeywordKind::Episode)) {
+      add_element_from_token(ElementKind::Episode, *token);
+      tokens[index.keywords(KeywordKind::Episode).front()].element_kind = ElementKind::Episode;
+      return;
     }
   }
   {
-    static constexpr auto is_episode_prefix = [](const Token& token, std::smatch& matches) {
-      static const std::regex pattern{R"((?:E|E[Pp]|Eps)(\d{1,4})(?:[vV](\d))?)"};
-      return std::regex_match(token.value, matches, pattern);
-    };
-
-    std::smatch matches;
-
     for (auto& token : tokens | filter(is_free_token)) {
-      if (is_episode_prefix(token, matches)) {
-        add_element_from_token(ElementKind::Episode, token, matches[1].str(),
-                               token.position + matches.position(1));
-        if (matches[2].matched) {
-          add_element(ElementKind::ReleaseVersion, matches[2].str(),
-                      token.position + matches.position(2));
+      if (const auto match = match_episode_prefix(token.value)) {
+        const auto [episode, version] = *match;
+        add_element_from_token(ElementKind::Episode, token, episode, position_of(token, episode));
+        if (!version.empty()) {
+          add_element(ElementKind::ReleaseVersion, version, position_of(token, version));
         }
-        return elements;
+        return;
       }
     }
   }
 
   // Number comes before another number (e.g. `8 & 10`, `01 of 24`)
   {
-    auto view = tokens | filter(is_free_token) | filter(is_numeric_token);
-
-    for (auto it = view.begin(); it != view.end(); ++it) {
+    for (const size_t i : free_numbers()) {
       // skip if delimiter but not '&'
-      auto token = std::ranges::find_if(
-          std::next(it.base().base()), tokens.end(),
-          [](const Token& token) { return is_not_delimiter_token(token) || token.value == "&"; });
-      if (token == tokens.end()) continue;
+      size_t j = i + 1;
+      while (j < tokens.size() && is_delimiter_token(tokens[j]) && tokens[j].value != "&") ++j;
+      if (j == tokens.size()) continue;
       // check if '&' or "of"
-      if (token->value != "&" && token->value != "of") continue;
+      if (tokens[j].value != "&" && tokens[j].value != "of") continue;
       // skip if delimiter
-      auto next_token = find_next_token(tokens, token, is_not_delimiter_token);
-      if (next_token == tokens.end()) continue;
+      const size_t k = index.next_non_delimiter(j);
+      if (k == tokens.size()) continue;
       // check if number
-      if (!is_numeric_token(*next_token)) continue;
-      add_element_from_token(ElementKind::Episode, *it);
-      add_element_from_token(ElementKind::Episode, *next_token);
-      return elements;
+      if (!is_numeric_token(tokens[k])) continue;
+      add_element_from_token(ElementKind::Episode, tokens[i]);
+      add_element_from_token(ElementKind::Episode, tokens[k]);
+      return;
     }
   }
 
   // Single episode (e.g. `01v2`)
   {
-    static constexpr auto is_single_episode = [](const Token& token, std::smatch& matches) {
-      static const std::regex pattern{R"((\d{1,4})[vV](\d))"};
-      return std::regex_match(token.value, matches, pattern);
-    };
-
-    std::smatch matches;
-
     for (auto& token : tokens | filter(is_free_token)) {
-      if (is_single_episode(token, matches)) {
-        add_element_from_token(ElementKind::Episode, token, matches[1].str(),
-                               token.position + matches.position(1));
-        add_element(ElementKind::ReleaseVersion, matches[2].str(),
-                    token.position + matches.position(2));
-        return elements;
+      if (const auto match = match_single_episode(token.value)) {
+        const auto [episode, version] = *match;
+        add_element_from_token(ElementKind::Episode, token, episode, position_of(token, episode));
+        add_element(ElementKind::ReleaseVersion, version, position_of(token, version));
+        return;
       }
     }
   }
 
   // Multi episode (e.g. `01-02`, `03-05v2`)
   {
-    static constexpr auto is_multi_episode = [](const Token& token, std::smatch& matches) {
-      static const std::regex pattern{R"((\d{1,4})(?:[vV](\d))?[-~&+])"
-                                      R"((\d{1,4})(?:[vV](\d))?)"};
-      return std::regex_match(token.value, matches, pattern);
-    };
-
-    std::smatch matches;
-
     for (auto& token : tokens | filter(is_free_token)) {
-      if (is_multi_episode(token, matches)) {
-        auto lower = matches[1].str();
-        auto upper = matches[3].str();
+      if (const auto match = match_multi_episode(token.value)) {
+        const auto [lower, lower_version, upper, upper_version] = *match;
         if (to_int(lower) >= to_int(upper)) continue;  // avoid matching `009-1`, `5-2`, etc.
-        add_element_from_token(ElementKind::Episode, token, lower,
-                               token.position + matches.position(1));
-        if (matches[2].matched) {
-          add_element(ElementKind::ReleaseVersion, matches[2].str(),
-                      token.position + matches.position(2));
+        add_element_from_token(ElementKind::Episode, token, lower, position_of(token, lower));
+        if (!lower_version.empty()) {
+          add_element(ElementKind::ReleaseVersion, lower_version,
+                      position_of(token, lower_version));
         }
-        add_element_from_token(ElementKind::Episode, token, upper,
-                               token.position + matches.position(3));
-        if (matches[4].matched) {
-          add_element(ElementKind::ReleaseVersion, matches[4].str(),
-                      token.position + matches.position(4));
+        add_element_from_token(ElementKind::Episode, token, upper, position_of(token, upper));
+        if (!upper_version.empty()) {
+          add_element(ElementKind::ReleaseVersion, upper_version,
+                      position_of(token, upper_version));
         }
-        return elements;
+        return;
       }
     }
   }
 
   // Season and episode (e.g. `2x01`, `S01E03`, `S01-02xE001-150`)
   {
-    static constexpr auto is_season_and_episode = [](const Token& token, std::smatch& matches) {
-      static const std::regex pattern{
-          "S?"
-          "(\\d{1,2})(?:-S?(\\d{1,2}))?"
-          "(?:x|[ ._-x]?E)"
-          "(\\d{1,4})(?:-E?(\\d{1,4}))?"
-          "(?:[vV](\\d))?"};
-      return std::regex_match(token.value, matches, pattern);
-    };
-
-    std::smatch matches;
-
     for (auto& token : tokens | filter(is_free_token)) {
-      if (is_season_and_episode(token, matches)) {
-        if (to_int(matches[1].str()) == 0) continue;
-        add_element(ElementKind::Season, matches[1].str(), token.position + matches.position(1));
-        if (matches[2].matched) {
-          add_element(ElementKind::Season, matches[2].str(), token.position + matches.position(2));
+      if (const auto match = match_season_and_episode(token.value)) {
+        const auto [season, last_season, episode, last_episode, version] = *match;
+        if (to_int(season) == 0) continue;
+        add_element(ElementKind::Season, season, position_of(token, season));
+        if (!last_season.empty()) {
+          add_element(ElementKind::Season, last_season, position_of(token, last_season));
         }
-        add_element_from_token(ElementKind::Episode, token, matches[3].str(),
-                               token.position + matches.position(3));
-        if (matches[4].matched) {
-          add_element(ElementKind::Episode, matches[4].str(), token.position + matches.position(4));
+        add_element_from_token(ElementKind::Episode, token, episode, position_of(token, episode));
+        if (!last_episode.empty()) {
+          add_element(ElementKind::Episode, last_episode, position_of(token, last_episode));
         }
-        if (matches[5].matched) {
-          add_element(ElementKind::ReleaseVersion, matches[5].str(),
-                      token.position + matches.position(5));
+        if (!version.empty()) {
+          add_element(ElementKind::ReleaseVersion, version, position_of(token, version));
         }
-        return elements;
+        return;
       }
     }
   }
 
   // Type and episode (e.g. `ED1`, `OP4a`, `OVA2`)
   {
-    static constexpr auto is_type_keyword = [](const Token& token) {
-      return token.keyword && token.keyword->kind == KeywordKind::Type;
-    };
-
-    auto type_token = std::ranges::find_if(tokens, is_type_keyword);
-
     // Check next token for a number
-    if (auto token = find_next_token(tokens, type_token, is_not_delimiter_token);
-        token != tokens.end()) {
-      if (is_free_token(*token) && is_numeric_token(*token)) {
-        add_element_from_token(ElementKind::Episode, *token);
-        return elements;
-      }
+    if (auto token = find_number_after_keyword(KeywordKind::Type)) {
+      add_element_from_token(ElementKind::Episode, *token);
+      return;
     }
   }
 
   // Fractional episode (e.g. `07.5`)
   {
-    for (auto [number, delimiter, fraction] : tokens | adjacent<3>) {
-      if (is_free_token(number) && is_numeric_token(number)) {
-        if (is_delimiter_token(delimiter) && delimiter.value == ".") {
-          // We don't allow any fractional part other than `.5`, because there are cases
-          // where such a number is a part of the title (e.g. `Evangelion: 1.11`,
-          // `Tokyo Magnitude 8.0`) or a keyword (e.g. `5.1`).
-          if (is_free_token(fraction) && fraction.value == "5") {
-            add_element_from_token(
-                ElementKind::Episode, number,
-                std::format("{}{}{}", number.value, delimiter.value, fraction.value));
-            delimiter.element_kind = ElementKind::Episode;
-            fraction.element_kind = ElementKind::Episode;
-            return elements;
-          }
+    for (const size_t i : free_numbers()) {
+      if (i + 2 >= tokens.size()) break;
+      auto& number = tokens[i];
+      auto& delimiter = tokens[i + 1];
+      auto& fraction = tokens[i + 2];
+      if (is_delimiter_token(delimiter) && delimiter.value == ".") {
+        // We don't allow any fractional part other than `.5`, because there are cases
+        // where such a number is a part of the title (e.g. `Evangelion: 1.11`,
+        // `Tokyo Magnitude 8.0`) or a keyword (e.g. `5.1`).
+        if (is_free_token(fraction) && fraction.value == "5") {
+          // Adjacent tokens are contiguous slices of the input
+          const std::string_view value{number.value.data(),
+                                       fraction.value.data() + fraction.value.size()};
+          add_element_from_token(ElementKind::Episode, number, value);
+          delimiter.element_kind = ElementKind::Episode;
+          fraction.element_kind = ElementKind::Episode;
+          return;
         }
       }
     }
@@ -221,43 +181,28 @@ inline std::vector<Element> parse_episode(std::span<Token> tokens) noexcept {
 
   // Number sign (e.g. `#01`, `#02-03v2`)
   {
-    static constexpr auto is_number_sign = [](const Token& token, std::smatch& matches) {
-      static const std::regex pattern{"#(\\d{1,4})(?:[-~&+](\\d{1,4}))?(?:[vV](\\d))?"};
-      return token.value.starts_with('#') && std::regex_match(token.value, matches, pattern);
-    };
-
-    std::smatch matches;
-
     for (auto& token : tokens | filter(is_free_token)) {
-      if (is_number_sign(token, matches)) {
-        add_element_from_token(ElementKind::Episode, token, matches[1].str(),
-                               token.position + matches.position(1));
-        if (matches[2].matched) {
-          add_element(ElementKind::Episode, matches[2].str(), token.position + matches.position(2));
+      if (const auto match = match_number_sign(token.value)) {
+        const auto [episode, last_episode, version] = *match;
+        add_element_from_token(ElementKind::Episode, token, episode, position_of(token, episode));
+        if (!last_episode.empty()) {
+          add_element(ElementKind::Episode, last_episode, position_of(token, last_episode));
         }
-        if (matches[3].matched) {
-          add_element(ElementKind::ReleaseVersion, matches[3].str(),
-                      token.position + matches.position(3));
+        if (!version.empty()) {
+          add_element(ElementKind::ReleaseVersion, version, position_of(token, version));
         }
-        return elements;
+        return;
       }
     }
   }
 
   // Japanese counter (e.g. `第01話`)
   {
-    static constexpr auto is_japanese_counter = [](const Token& token, std::smatch& matches) {
-      static const std::regex pattern{"(?:第)?(\\d{1,4})話"};
-      return std::regex_match(token.value, matches, pattern);
-    };
-
-    std::smatch matches;
-
     for (auto& token : tokens | filter(is_free_token)) {
-      if (is_japanese_counter(token, matches)) {
-        add_element_from_token(ElementKind::Episode, token, matches[1].str(),
-                               token.position + matches.position(1));
-        return elements;
+      if (const auto match = match_japanese_episode(token.value)) {
+        const auto [episode] = *match;
+        add_element_from_token(ElementKind::Episode, token, episode, position_of(token, episode));
+        return;
       }
     }
   }
@@ -273,65 +218,50 @@ inline std::vector<Element> parse_episode(std::span<Token> tokens) noexcept {
       return token.kind == TokenKind::Delimiter && is_dash(token.value.front());
     };
 
-    auto view = tokens | filter(is_dash_token);
-
-    for (auto it = view.begin(); it != view.end(); ++it) {
-      auto next_token = std::ranges::find_if(it.base(), tokens.end(), is_not_delimiter_token);
-      if (next_token != tokens.end() && is_numeric_token(*next_token)) {
-        add_element_from_token(ElementKind::Episode, *next_token);
-        return elements;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      if (!is_dash_token(tokens[i])) continue;
+      const size_t j = index.next_non_delimiter(i);
+      if (j < tokens.size() && is_numeric_token(tokens[j])) {
+        add_element_from_token(ElementKind::Episode, tokens[j]);
+        return;
       }
     }
   }
 
   // Isolated number (e.g. `[12]`, `(2006)`)
   {
-    using window_t = std::tuple<Token&, Token&, Token&>;
-
-    static constexpr auto is_isolated = [](window_t tokens) {
-      return std::get<0>(tokens).kind == TokenKind::OpenBracket &&
-             std::get<2>(tokens).kind == TokenKind::CloseBracket;
-    };
-
-    static constexpr auto is_free_number = [](window_t tokens) {
-      auto& token = std::get<1>(tokens);
-      return is_free_token(token) && is_numeric_token(token);
-    };
-
-    auto view = tokens | adjacent<3> | filter(is_isolated) | filter(is_free_number) | take(1);
-
-    if (!view.empty()) {
-      add_element_from_token(ElementKind::Episode, std::get<1>(view.front()));
-      return elements;
+    for (const size_t i : free_numbers()) {
+      if (0 < i && i + 1 < tokens.size() && tokens[i - 1].kind == TokenKind::OpenBracket &&
+          tokens[i + 1].kind == TokenKind::CloseBracket) {
+        add_element_from_token(ElementKind::Episode, tokens[i]);
+        return;
+      }
     }
   }
 
   // Partial episode (e.g. `4a`, `111C`)
   {
-    static constexpr auto is_partial_episode = [](const Token& token) {
-      static const std::regex pattern{R"(\d{1,4}[ABCabc])"};
-      return std::regex_match(token.value, pattern);
+    static constexpr auto is_partial_episode_token = [](const Token& token) {
+      return is_partial_episode(token.value);
     };
 
-    auto view = tokens | filter(is_free_token) | filter(is_partial_episode) | take(1);
+    auto view = tokens | filter(is_free_token) | filter(is_partial_episode_token) | take(1);
     if (!view.empty()) {
       add_element_from_token(ElementKind::Episode, view.front());
-      return elements;
+      return;
     }
   }
 
   // Last number
   // @TODO: should not parse `1.11`, `Part 2`
   {
-    auto view = tokens | reverse | filter(is_free_token) | filter(is_numeric_token) | take(1);
+    auto view = free_numbers() | reverse | take(1);
 
     if (!view.empty()) {
-      add_element_from_token(ElementKind::Episode, view.front());
-      return elements;
+      add_element_from_token(ElementKind::Episode, tokens[view.front()]);
+      return;
     }
   }
-
-  return elements;
 }
 
 }  // namespace anitomy::detail
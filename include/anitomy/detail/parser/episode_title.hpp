@@ -1,7 +1,6 @@
 #pragma once
 
 #include <algorithm>
-#include <optional>
 #include <span>
 
 #include <anitomy/detail/element.hpp>
@@ -39,22 +38,16 @@ inline std::span<Token> find_episode_title(std::span<Token> tokens) noexcept {
   return {first, last};
 }
 
-inline std::optional<Element> parse_episode_title(std::span<Token> tokens) noexcept {
+template <typename Elements>
+inline void parse_episode_title(std::span<Token> tokens, Elements& elements) noexcept {
   const auto span = find_episode_title(tokens);
-  if (span.empty()) return {};
-
-  std::string value = build_element_value(span, KeepDelimiters::No);
-  if (value.empty()) return {};
+  if (span.empty() || is_empty_element_value(span, KeepDelimiters::No)) return;
 
   for (auto& token : span) {
     token.element_kind = ElementKind::EpisodeTitle;
   }
 
-  return Element{
-      .kind = ElementKind::EpisodeTitle,
-      .value = std::move(value),
-      .position = span.front().position,
-  };
+  append_element(elements, ElementKind::EpisodeTitle, span, KeepDelimiters::No);
 }
 
 }  // namespace anitomy::detail
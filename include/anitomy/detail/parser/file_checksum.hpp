@@ -1,17 +1,18 @@
 #pragma once
 
 #include <algorithm>
-#include <optional>
 #include <ranges>
 #include <span>
 
+#include <anitomy/detail/element.hpp>
 #include <anitomy/detail/token.hpp>
 #include <anitomy/detail/util.hpp>
 #include <anitomy/element.hpp>
 
 namespace anitomy::detail {
 
-inline std::optional<Element> parse_file_checksum(std::span<Token> tokens) noexcept {
+template <typename Elements>
+inline void parse_file_checksum(std::span<Token> tokens, Elements& elements) noexcept {
   using namespace std::views;
 
   // A checksum has 8 hexadecimal digits (e.g. `ABCD1234`)
@@ -22,17 +23,13 @@ inline std::optional<Element> parse_file_checksum(std::span<Token> tokens) noexc
   // Find the last free token that is a checksum
   auto view = tokens | reverse | filter(is_free_token) | filter(is_checksum) | take(1);
 
-  if (view.empty()) return std::nullopt;
+  if (view.empty()) return;
 
   auto& token = view.front();
 
   token.element_kind = ElementKind::FileChecksum;
 
-  return Element{
-      .kind = ElementKind::FileChecksum,
-      .value = token.value,
-      .position = token.position,
-  };
+  append_element(elements, ElementKind::FileChecksum, token.value, token.position);
 }
 
 }  // namespace anitomy::detail
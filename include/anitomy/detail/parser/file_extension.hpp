@@ -1,15 +1,18 @@
 #pragma once
 
-#include <optional>
 #include <ranges>
 #include <span>
 
+#include <anitomy/detail/element.hpp>
 #include <anitomy/detail/token.hpp>
 #include <anitomy/element.hpp>
+#include <anitomy/options.hpp>
 
 namespace anitomy::detail {
 
-inline std::optional<Element> parse_file_extension(std::span<Token> tokens) noexcept {
+template <typename Elements, typename ParseOptions = Options>
+inline void parse_file_extension(std::span<Token> tokens, const ParseOptions& options,
+                                 Elements& elements) noexcept {
   static constexpr auto is_file_extension = [](const Token& token) {
     return token.keyword && token.keyword->kind == KeywordKind::FileExtension;
   };
@@ -18,20 +21,17 @@ inline std::optional<Element> parse_file_extension(std::span<Token> tokens) noex
     return is_delimiter_token(token) && token.value == ".";
   };
 
-  if (tokens.size() < 2) return std::nullopt;
+  if (tokens.size() < 2) return;
 
   auto view = tokens | std::views::reverse | std::views::adjacent<2>;
   auto [last_token, prev_token] = view.front();
 
-  if (!is_file_extension(last_token) || !is_dot(prev_token)) return std::nullopt;
+  if (!is_file_extension(last_token) || !is_dot(prev_token)) return;
 
   last_token.element_kind = ElementKind::FileExtension;
 
-  return Element{
-      .kind = ElementKind::FileExtension,
-      .value = last_token.value,
-      .position = last_token.position,
-  };
+  append_element(elements, ElementKind::FileExtension, keyword_token_value(last_token, options),
+                 last_token.position);
 }
 
 }  // namespace anitomy::detail
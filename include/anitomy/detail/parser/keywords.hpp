@@ -3,18 +3,18 @@
 #include <map>
 #include <ranges>
 #include <span>
-#include <string>
 #include <string_view>
-#include <vector>
 
+#include <anitomy/detail/element.hpp>
 #include <anitomy/detail/token.hpp>
 #include <anitomy/element.hpp>
 #include <anitomy/options.hpp>
 
 namespace anitomy::detail {
 
-inline std::vector<Element> parse_keywords(std::span<Token> tokens,
-                                           const Options& options) noexcept {
+template <typename Elements, typename ParseOptions = Options>
+inline void parse_keywords(std::span<Token> tokens, const ParseOptions& options,
+                           Elements& elements) noexcept {
   static constexpr auto filter = std::views::filter;
 
   static const std::map<KeywordKind, ElementKind> table{
@@ -42,7 +42,7 @@ inline std::vector<Element> parse_keywords(std::span<Token> tokens,
       // clang-format on
   };
 
-  static const auto is_allowed = [&options](const Token& token) {
+  const auto is_allowed = [&options](const Token& token) {
     if (!token.keyword) {
       return false;
     }
@@ -55,26 +55,23 @@ inline std::vector<Element> parse_keywords(std::span<Token> tokens,
     return true;
   };
 
-  static constexpr auto token_value = [](const Token& token) -> std::string {
+  const auto token_value = [&options](const Token& token) -> std::string_view {
+    const auto value = keyword_token_value(token, options);
     switch (token.keyword->kind) {
       case KeywordKind::ReleaseVersion:
-        return token.value.substr(1);  // `v2` -> `2`
+        return value.substr(1);  // `v2` -> `2`
     }
-    return token.value;
+    return value;
   };
 
-  std::vector<Element> elements;
-
   for (auto& token : tokens | filter(is_keyword_token) | filter(is_allowed)) {
     if (const auto it = table.find(token.keyword->kind); it != table.end()) {
       if (!token.keyword->is_ambiguous() || token.is_enclosed) {
         token.element_kind = it->second;
       }
-      elements.emplace_back(it->second, token_value(token), token.position);
+      append_element(elements, it->second, token_value(token), token.position);
     }
   }
-
-  return elements;
 }
 
 }  // namespace anitomy::detail
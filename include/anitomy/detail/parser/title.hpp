@@ -1,18 +1,18 @@
 #pragma once
 
 #include <algorithm>
-#include <optional>
 #include <span>
 
-#include <anitomy/detail/container.hpp>
 #include <anitomy/detail/element.hpp>
 #include <anitomy/detail/token.hpp>
-#include <anitomy/detail/util.hpp>
+#include <anitomy/detail/token_index.hpp>
 #include <anitomy/element.hpp>
 
 namespace anitomy::detail {
 
-inline std::span<Token> find_title(std::span<Token> tokens) noexcept {
+template <typename Allocator>
+inline std::span<Token> find_title(std::span<Token> tokens,
+                                   const TokenIndex<Allocator>& index) noexcept {
   // Find the first free unenclosed range
   // e.g. `[Group] Title - Episode [Info]`
   //               ^-------^
@@ -36,42 +36,48 @@ inline std::span<Token> find_title(std::span<Token> tokens) noexcept {
   // Prevent titles with mismatched brackets
   // e.g. `Title (`      -> `Title `
   // e.g. `Title [Info ` -> `Title `
-  if (const auto open_brackets = find_all_if(first, last, is_open_bracket_token);
-      !open_brackets.empty()) {
-    if (std::ranges::count_if(first, last, is_close_bracket_token) != open_brackets.size()) {
-      last = open_brackets.back();
+  {
+    auto last_open_bracket = last;
+    std::ptrdiff_t balance = 0;
+    for (auto it = first; it != last; ++it) {
+      if (is_open_bracket_token(*it)) {
+        last_open_bracket = it;
+        ++balance;
+      } else if (is_close_bracket_token(*it)) {
+        --balance;
+      }
     }
+    if (balance != 0 && last_open_bracket != last) last = last_open_bracket;
   }
 
   // Prevent titles ending with brackets (except parentheses)
   // e.g. `Title [Group]` -> `Title `
   // e.g. `Title (TV)`    -> *no change*
-  if (auto token = find_prev_token(tokens, last, is_not_delimiter_token);
-      is_close_bracket_token(*token) && token->value != ")") {
-    if (token = find_prev_token(tokens, token, is_open_bracket_token); token != tokens.end()) {
-      last = token;
-    }
+  // e.g. `Title]`        -> `Title`
+  //
+  // The range always contains a non-delimiter token (i.e. the first one).
+  const auto position = [&tokens](auto it) { return static_cast<size_t>(it - tokens.begin()); };
+  if (const size_t i = index.prev_non_delimiter(position(last));
+      is_close_bracket_token(tokens[i]) && tokens[i].value != ")") {
+    const auto& token = tokens[i];
+    const bool is_matched = has_matching_bracket(token) && token.matching_bracket > position(first);
+    last = tokens.begin() + (is_matched ? token.matching_bracket : i);
   }
 
   return {first, last};
 }
 
-inline std::optional<Element> parse_title(std::span<Token> tokens) noexcept {
-  const auto span = find_title(tokens);
-  if (span.empty()) return {};
-
-  std::string value = build_element_value(span, KeepDelimiters::No);
-  if (value.empty()) return {};
+template <typename Elements, typename Allocator>
+inline void parse_title(std::span<Token> tokens, const TokenIndex<Allocator>& index,
+                        Elements& elements) noexcept {
+  const auto span = find_title(tokens, index);
+  if (span.empty() || is_empty_element_value(span, KeepDelimiters::No)) return;
 
   for (auto& token : span) {
     token.element_kind = ElementKind::Title;
   }
 
-  return Element{
-      .kind = ElementKind::Title,
-      .value = std::move(value),
-      .position = span.front().position,
-  };
+  append_element(elements, ElementKind::Title, span, KeepDelimiters::No);
 }
 
 }  // namespace anitomy::detail
@@ -1,44 +1,42 @@
 #pragma once
 
 #include <ranges>
-#include <regex>
 #include <span>
-#include <vector>
 
+#include <anitomy/detail/element.hpp>
+#include <anitomy/detail/matcher.hpp>
 #include <anitomy/detail/token.hpp>
 #include <anitomy/element.hpp>
 
 namespace anitomy::detail {
 
-inline std::vector<Element> parse_video_resolution(std::span<Token> tokens) noexcept {
+template <typename Elements>
+inline void parse_video_resolution(std::span<Token> tokens, Elements& elements) noexcept {
   using namespace std::views;
 
   // A video resolution can be in `1080p` or `1920x1080` format
-  static constexpr auto is_video_resolution = [](const Token& token) {
-    static const std::regex pattern{R"(\d{3,4}(?:[ip]|[xX×]\d{3,4}[ip]?))"};
-    return std::regex_match(token.value, pattern);
+  static constexpr auto is_video_resolution_token = [](const Token& token) {
+    return is_video_resolution(token.value);
   };
 
-  std::vector<Element> elements;
+  const size_t size = elements.size();
 
   // Find all free tokens matching the pattern
-  for (auto& token : tokens | filter(is_free_token) | filter(is_video_resolution)) {
+  for (auto& token : tokens | filter(is_free_token) | filter(is_video_resolution_token)) {
     token.element_kind = ElementKind::VideoResolution;
-    elements.emplace_back(ElementKind::VideoResolution, token.value, token.position);
+    append_element(elements, ElementKind::VideoResolution, token.value, token.position);
   }
 
   // If not found, look for special cases
-  if (elements.empty()) {
+  if (elements.size() == size) {
     for (auto& token : tokens | filter(is_free_token) | filter(is_numeric_token)) {
       if (token.value == "1080") {
         token.element_kind = ElementKind::VideoResolution;
-        elements.emplace_back(ElementKind::VideoResolution, token.value, token.position);
+        append_element(elements, ElementKind::VideoResolution, token.value, token.position);
         break;
       }
     }
   }
-
-  return elements;
 }
 
 }  // namespace anitomy::detail
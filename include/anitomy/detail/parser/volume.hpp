@@ -1,37 +1,30 @@
 #pragma once
 
-#include <optional>
-#include <ranges>
 #include <span>
 
-#include <anitomy/detail/container.hpp>
+#include <anitomy/detail/element.hpp>
 #include <anitomy/detail/token.hpp>
+#include <anitomy/detail/token_index.hpp>
 #include <anitomy/element.hpp>
 
 namespace anitomy::detail {
 
-inline std::optional<Element> parse_volume(std::span<Token> tokens) noexcept {
-  static constexpr auto is_volume_keyword = [](const Token& token) {
-    return token.keyword && token.keyword->kind == KeywordKind::Volume;
-  };
+template <typename Elements, typename Allocator>
+inline void parse_volume(std::span<Token> tokens, const TokenIndex<Allocator>& index,
+                         Elements& elements) noexcept {
+  const auto volume_keywords = index.keywords(KeywordKind::Volume);
+  if (volume_keywords.empty()) return;
 
-  auto volume_token = std::ranges::find_if(tokens, is_volume_keyword);
+  auto& volume_token = tokens[volume_keywords.front()];
 
   // Check next token for a number
-  if (auto token = find_next_token(tokens, volume_token, is_not_delimiter_token);
-      token != tokens.end()) {
-    if (is_free_token(*token) && is_numeric_token(*token)) {
-      token->element_kind = ElementKind::Volume;
-      volume_token->element_kind = ElementKind::Volume;
-      return Element{
-          .kind = ElementKind::Volume,
-          .value = token->value,
-          .position = token->position,
-      };
+  if (const size_t i = index.next_non_delimiter(volume_keywords.front()); i < tokens.size()) {
+    if (auto& token = tokens[i]; is_free_token(token) && is_numeric_token(token)) {
+      token.element_kind = ElementKind::Volume;
+      volume_token.element_kind = ElementKind::Volume;
+      append_element(elements, ElementKind::Volume, token.value, token.position);
     }
   }
-
-  return std::nullopt;
 }
 
 }  // namespace anitomy::detail
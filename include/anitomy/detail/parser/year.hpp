@@ -1,49 +1,38 @@
 #pragma once
 
-#include <optional>
-#include <ranges>
 #include <span>
-#include <tuple>
 
+#include <anitomy/detail/element.hpp>
 #include <anitomy/detail/token.hpp>
+#include <anitomy/detail/token_index.hpp>
+#include <anitomy/detail/util.hpp>
 #include <anitomy/element.hpp>
 
 namespace anitomy::detail {
 
-inline std::optional<Element> parse_year(std::span<Token> tokens) noexcept {
-  using namespace std::views;
-  using window_t = std::tuple<Token&, Token&, Token&>;
-
-  static constexpr auto is_isolated = [](window_t tokens) {
-    return std::get<0>(tokens).kind == TokenKind::OpenBracket &&
-           std::get<2>(tokens).kind == TokenKind::CloseBracket;
-  };
-
-  static constexpr auto is_free_number = [](window_t tokens) {
-    auto& token = std::get<1>(tokens);
-    return is_free_token(token) && is_numeric_token(token);
+template <typename Elements, typename Allocator>
+inline void parse_year(std::span<Token> tokens, const TokenIndex<Allocator>& index,
+                       Elements& elements) noexcept {
+  const auto is_isolated = [&tokens](const size_t i) {
+    return 0 < i && i + 1 < tokens.size() && tokens[i - 1].kind == TokenKind::OpenBracket &&
+           tokens[i + 1].kind == TokenKind::CloseBracket;
   };
 
-  static constexpr auto is_year = [](window_t tokens) {
-    const int number = to_int(std::get<1>(tokens).value);
+  static constexpr auto is_year = [](const Token& token) {
+    const int number = to_int(token.value);
     return 1950 < number && number < 2050;
   };
 
   // Find the first free isolated number within the interval
-  auto view = tokens | adjacent<3> | filter(is_isolated) | filter(is_free_number) |
-              filter(is_year) | take(1);
+  for (const size_t i : index.numbers()) {
+    auto& token = tokens[i];
+    if (!is_isolated(i) || !is_free_token(token) || !is_year(token)) continue;
 
-  if (view.empty()) return std::nullopt;
+    token.element_kind = ElementKind::Year;
 
-  auto& token = std::get<1>(view.front());
-
-  token.element_kind = ElementKind::Year;
-
-  return Element{
-      .kind = ElementKind::Year,
-      .value = token.value,
-      .position = token.position,
-  };
+    append_element(elements, ElementKind::Year, token.value, token.position);
+    return;
+  }
 }
 
 }  // namespace anitomy::detail
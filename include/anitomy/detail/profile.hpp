@@ -0,0 +1,230 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#ifdef ANITOMY_PROFILE
+#include <chrono>
+#include <mutex>
+#endif
+
+// Optional instrumentation of the parser, which measures the time spent in each stage and counts
+// some of the operations that are performed. Define `ANITOMY_PROFILE` to enable it. Otherwise, the
+// macros below expand to nothing, and there is no overhead at all.
+//
+// Measurements are collected per thread without synchronization, and are merged into a global
+// profile when the thread exits.
+
+namespace anitomy::detail {
+
+enum class ProfileStage {
+  Tokenize,
+  Index,
+  FileExtension,
+  Keywords,
+  FileChecksum,
+  VideoResolution,
+  Year,
+  Season,
+  Episode,  // including volume
+  Title,
+  ReleaseGroup,
+  EpisodeTitle,
+  Sort,
+  Replay,  // instead of the stages after tokenize, for inputs of a known shape
+};
+
+enum class ProfileCounter {
+  KeywordProbes,  // steps taken in the keyword trie
+  MatcherCalls,   // patterns matched against a token
+  Allocations,    // made within the stages, if the application replaces `operator new`
+};
+
+constexpr std::string_view to_string(const ProfileStage stage) noexcept {
+  using enum ProfileStage;
+  // clang-format off
+  switch (stage) {
+    case Tokenize: return "tokenize";
+    case Index: return "index";
+    case FileExtension: return "file_extension";
+    case Keywords: return "keywords";
+    case FileChecksum: return "file_checksum";
+    case VideoResolution: return "video_resolution";
+    case Year: return "year";
+    case Season: return "season";
+    case Episode: return "episode";
+    case Title: return "title";
+    case ReleaseGroup: return "release_group";
+    case EpisodeTitle: return "episode_title";
+    case Sort: return "sort";
+    case Replay: return "replay";
+  }
+  // clang-format on
+  return "?";
+}
+
+constexpr std::string_view to_string(const ProfileCounter counter) noexcept {
+  using enum ProfileCounter;
+  // clang-format off
+  switch (counter) {
+    case KeywordProbes: return "keyword_probes";
+    case MatcherCalls: return "matcher_calls";
+    case Allocations: return "allocations";
+  }
+  // clang-format on
+  return "?";
+}
+
+struct Profile {
+  static constexpr size_t stage_count = static_cast<size_t>(ProfileStage::Replay) + 1;
+  static constexpr size_t counter_count = static_cast<size_t>(ProfileCounter::Allocations) + 1;
+
+  struct Stage {
+    uint64_t calls = 0;
+    uint64_t nanoseconds = 0;
+  };
+
+  std::array<Stage, stage_count> stages{};
+  std::array<uint64_t, counter_count> counters{};
+
+  [[nodiscard]] constexpr Stage& operator[](const ProfileStage stage) noexcept {
+    return stages[static_cast<size_t>(stage)];
+  }
+
+  [[nodiscard]] constexpr uint64_t& operator[](const ProfileCounter counter) noexcept {
+    return counters[static_cast<size_t>(counter)];
+  }
+
+  constexpr Profile& operator+=(const Profile& other) noexcept {
+    for (size_t i = 0; i < stage_count; ++i) {
+      stages[i].calls += other.stages[i].calls;
+      stages[i].nanoseconds += other.stages[i].nanoseconds;
+    }
+    for (size_t i = 0; i < counter_count; ++i) {
+      counters[i] += other.counters[i];
+    }
+    return *this;
+  }
+};
+
+#ifdef ANITOMY_PROFILE
+
+struct GlobalProfile {
+  std::mutex mutex;
+  Profile profile;
+};
+
+[[nodiscard]] inline GlobalProfile& global_profile() noexcept {
+  static GlobalProfile global;
+  return global;
+}
+
+// Trivially destructible, so that it can be used at any point in the lifetime of the thread (e.g.
+// from `operator new`)
+inline thread_local constinit Profile thread_profile{};
+
+// Number of stages that are being measured on the thread, so that allocations can be counted only
+// within them (see `is_profiling_stage`)
+inline thread_local constinit uint32_t profile_depth = 0;
+
+[[nodiscard]] inline bool is_profiling_stage() noexcept {
+  return profile_depth != 0;
+}
+
+// Merges the profile of the thread into the global profile when the thread exits
+struct ThreadProfileMerger {
+  ~ThreadProfileMerger() {
+    auto& global = global_profile();
+    std::lock_guard lock{global.mutex};
+    global.profile += thread_profile;
+    thread_profile = {};
+  }
+};
+
+inline void register_thread_profile() noexcept {
+  thread_local ThreadProfileMerger merger;
+  (void)merger;
+}
+
+inline void profile_count(const ProfileCounter counter, const uint64_t n = 1) noexcept {
+  thread_profile[counter] += n;
+}
+
+// Measures the time from its construction until its destruction
+class ProfileScope final {
+public:
+  constexpr explicit ProfileScope(const ProfileStage stage) noexcept : stage_{stage} {
+    if !consteval {
+      register_thread_profile();
+      ++profile_depth;
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  constexpr ~ProfileScope() {
+    if !consteval {
+      const auto elapsed = std::chrono::steady_clock::now() - start_;
+      auto& stage = thread_profile[stage_];
+      stage.calls += 1;
+      stage.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+      --profile_depth;
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  ProfileStage stage_;
+  std::chrono::steady_clock::time_point start_{};
+};
+
+// Returns the measurements of the threads that have exited, and of the calling thread.
+[[nodiscard]] inline Profile collect_profile() noexcept {
+  auto& global = global_profile();
+  std::lock_guard lock{global.mutex};
+  Profile profile = global.profile;
+  profile += thread_profile;
+  return profile;
+}
+
+inline void reset_profile() noexcept {
+  auto& global = global_profile();
+  std::lock_guard lock{global.mutex};
+  global.profile = {};
+  thread_profile = {};
+}
+
+#define ANITOMY_PROFILE_CONCAT_(a, b) a##b
+#define ANITOMY_PROFILE_CONCAT(a, b) ANITOMY_PROFILE_CONCAT_(a, b)
+
+// Measures the rest of the enclosing scope as the given stage
+#define ANITOMY_PROFILE_SCOPE(stage)                                                               \
+  const ::anitomy::detail::ProfileScope ANITOMY_PROFILE_CONCAT(profile_scope_, __LINE__) {         \
+    ::anitomy::detail::ProfileStage::stage                                                         \
+  }
+
+// Increments the given counter
+#define ANITOMY_PROFILE_COUNT(counter)                                                             \
+  do {                                                                                             \
+    if !consteval {                                                                                \
+      ::anitomy::detail::profile_count(::anitomy::detail::ProfileCounter::counter);                \
+    }                                                                                              \
+  } while (false)
+
+#else
+
+[[nodiscard]] inline Profile collect_profile() noexcept {
+  return {};
+}
+
+inline void reset_profile() noexcept {
+}
+
+#define ANITOMY_PROFILE_SCOPE(stage) static_cast<void>(0)
+#define ANITOMY_PROFILE_COUNT(counter) static_cast<void>(0)
+
+#endif
+
+}  // namespace anitomy::detail
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace anitomy::detail {
+
+// Calls `fn(first, last)` for consecutive chunks of the range `[0, count)`, spread across
+// `thread_count` threads (including the calling thread). Returns when all chunks are done, or when
+// a stop is requested, in which case the remaining chunks are skipped.
+//
+// The range is split evenly between the workers up front. Each worker claims chunks from the front
+// of its own share, and once that is exhausted, steals chunks from the others. This keeps every
+// thread busy even if the cost of the inputs is unevenly distributed.
+template <typename Fn>
+void parallel_for(const size_t count, size_t thread_count, size_t chunk_size,
+                  const std::stop_token& stop_token, Fn&& fn) {
+  // Each share is on its own cache line, to avoid false sharing between the workers
+  struct alignas(64) Share {
+    std::atomic<size_t> next;
+    size_t last;
+  };
+
+  if (!count) return;
+  chunk_size = std::clamp<size_t>(chunk_size, 1, count);  // e.g. `SIZE_MAX` for a single chunk
+  if (!thread_count) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  thread_count = std::clamp<size_t>(thread_count, 1, (count + chunk_size - 1) / chunk_size);
+
+  const auto shares = std::make_unique<Share[]>(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    shares[i].next = i * count / thread_count;
+    shares[i].last = (i + 1) * count / thread_count;
+  }
+
+  const auto work = [&](const size_t worker) {
+    for (size_t i = 0; i < thread_count; ++i) {
+      auto& share = shares[(worker + i) % thread_count];
+      while (!stop_token.stop_requested()) {
+        const size_t first = share.next.fetch_add(chunk_size, std::memory_order_relaxed);
+        if (first >= share.last) break;
+        fn(first, std::min(first + chunk_size, share.last));
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+      threads.emplace_back(work, i);
+    }
+    work(0);
+  }
+}
+
+// A fixed set of threads (including the calling thread) that run one job at a time. Unlike
+// `parallel_for`, the threads are kept alive between jobs, and `fn` is given the index of the
+// worker, so that callers can keep per-worker state (e.g. an `Engine`) warm across jobs.
+class WorkerPool final {
+public:
+  using job_t = std::function<void(size_t worker, size_t first, size_t last)>;
+
+  explicit WorkerPool(size_t thread_count) {
+    if (!thread_count) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    threads_.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+      threads_.emplace_back([this, i](const std::stop_token& stop_token) { work(i, stop_token); });
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  [[nodiscard]] size_t size() const noexcept {
+    return threads_.size() + 1;
+  }
+
+  // Calls `fn(worker, first, last)` for consecutive chunks of the range `[0, count)`, and returns
+  // when all chunks are done. Must not be called concurrently.
+  void run(const size_t count, const size_t chunk_size, const job_t& fn) {
+    if (!count) return;
+    {
+      std::lock_guard lock{mutex_};
+      job_ = &fn;
+      count_ = count;
+      chunk_size_ = std::clamp<size_t>(chunk_size, 1, count);
+      next_ = 0;
+      busy_ = threads_.size();
+      ++generation_;
+    }
+    job_ready_.notify_all();
+    process(0);
+    std::unique_lock lock{mutex_};
+    job_done_.wait(lock, [this] { return busy_ == 0; });
+  }
+
+private:
+  void work(const size_t worker, const std::stop_token& stop_token) {
+    size_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock lock{mutex_};
+        if (!job_ready_.wait(lock, stop_token, [&] { return generation_ != generation; })) return;
+        generation = generation_;
+      }
+      process(worker);
+      {
+        std::lock_guard lock{mutex_};
+        if (--busy_ == 0) job_done_.notify_one();
+      }
+    }
+  }
+
+  void process(const size_t worker) {
+    while (true) {
+      const size_t first = next_.fetch_add(chunk_size_, std::memory_order_relaxed);
+      if (first >= count_) break;
+      (*job_)(worker, first, std::min(first + chunk_size_, count_));
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable_any job_ready_;
+  std::condition_variable job_done_;
+  const job_t* job_ = nullptr;
+  size_t count_ = 0;
+  size_t chunk_size_ = 1;
+  std::atomic<size_t> next_ = 0;
+  size_t busy_ = 0;
+  size_t generation_ = 0;
+  std::vector<std::jthread> threads_;  // last, so that they are stopped first
+};
+
+}  // namespace anitomy::detail
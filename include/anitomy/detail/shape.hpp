@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <anitomy/detail/element.hpp>
+#include <anitomy/detail/options.hpp>
+#include <anitomy/detail/token.hpp>
+#include <anitomy/detail/util.hpp>
+#include <anitomy/element.hpp>
+#include <anitomy/options.hpp>
+
+// Most inputs of a feed share a handful of shapes (e.g. `[Group] Title - 01 [1080p].mkv`), and only
+// differ in words that the rules never look at. The shape of an input is its tokens, with the text
+// of such words left out. After an input is parsed, the way each of its elements was derived from
+// its tokens is remembered for its shape, so that the elements of later inputs with the same shape
+// can be derived the same way, without running the rules.
+
+namespace anitomy::detail {
+
+// Returns true if the rules treat the token the same regardless of its text, other than copying it
+// into an element. Update this when a rule starts to look at the text of tokens without digits.
+[[nodiscard]] inline bool is_opaque_token(const Token& token) noexcept {
+  if (token.kind != TokenKind::Text || token.keyword) return false;
+  const auto value = token.value;
+  if (value.empty() || std::ranges::any_of(value, is_digit)) return false;       // patterns
+  if (value.size() == 8 && std::ranges::all_of(value, is_xdigit)) return false;  // checksum
+  if (value == "of") return false;                                               // episode
+  if (value.size() > 7) return true;
+  return from_ordinal_number(value).empty() && from_roman_number(value).empty();  // season
+}
+
+// How an element is derived from the tokens of its input
+struct ShapeElement {
+  enum class Source : uint8_t {
+    Slice,                // input from `offset` in the first token to `end_offset` before the end
+                          // of the last token
+    Value,                // value of the tokens from the first until the last (exclusive)
+    ValueWithDelimiters,  // same, with delimiters kept as is
+    Literal,              // the same value in all inputs
+  };
+
+  ElementKind kind;
+  Source source;
+  uint32_t first = 0;
+  uint32_t last = 0;
+  uint32_t offset = 0;  // position of the element, from the start of the first token
+  uint32_t end_offset = 0;
+  std::string literal;
+};
+
+struct Shape {
+  bool is_replayable = false;  // false if the elements could not be traced back to the tokens
+  std::vector<ShapeElement> elements;
+};
+
+// Remembers the shapes of parsed inputs. Not thread-safe.
+class ShapeCache final {
+public:
+  explicit ShapeCache(const size_t capacity = 0) noexcept : capacity_{capacity} {
+  }
+
+  [[nodiscard]] constexpr size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  [[nodiscard]] inline size_t size() const noexcept {
+    return shapes_.size();
+  }
+
+  // Returns the shape of the tokens, if it is known. The signature of the tokens is kept for the
+  // next call to `insert`.
+  [[nodiscard]] inline const Shape* find(std::span<const Token> tokens, const Options& options) {
+    signature_.clear();
+    append_integer(fingerprint(options));
+    for (const auto& token : tokens) {
+      append_token(token);
+    }
+    const auto it = shapes_.find(signature_);
+    return it != shapes_.end() ? &it->second : nullptr;
+  }
+
+  // Remembers how the elements were derived from the tokens, for the signature of the last call to
+  // `find`. All shapes are forgotten once the capacity is reached.
+  template <typename Elements>
+  inline void insert(std::string_view input, std::span<Token> tokens, const Elements& elements) {
+    if (shapes_.size() >= capacity_) shapes_.clear();
+    shapes_.emplace(signature_, trace(input, tokens, elements));
+  }
+
+  // Derives the elements of the tokens as the shape describes
+  template <typename Elements>
+  static void replay(const Shape& shape, std::span<Token> tokens, Elements& elements) {
+    using enum ShapeElement::Source;
+    for (const auto& element : shape.elements) {
+      const auto& first = tokens[element.first];
+      const size_t position = first.position + element.offset;
+      switch (element.source) {
+        case Slice: {
+          const auto& last = tokens[element.last];
+          const char* end = last.value.data() + last.value.size() - element.end_offset;
+          const char* begin = first.value.data() + element.offset;
+          append_element(elements, element.kind, {begin, end}, position);
+          break;
+        }
+        case Value:
+        case ValueWithDelimiters: {
+          const auto keep = element.source == Value ? KeepDelimiters::No : KeepDelimiters::Yes;
+          elements.emplace_back(
+              element.kind,
+              build_element_value<element_string_t<Elements>>(
+                  tokens.subspan(element.first, element.last - element.first), keep,
+                  elements.get_allocator()),
+              position);
+          break;
+        }
+        case Literal:
+          append_element(elements, element.kind, element.literal, position);
+          break;
+      }
+    }
+  }
+
+private:
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const noexcept {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  template <typename T>
+  inline void append_integer(const T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      signature_.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+    }
+  }
+
+  // Includes everything about the token that the rules look at
+  inline void append_token(const Token& token) {
+    const bool is_opaque = is_opaque_token(token);
+    const uint8_t flags = token.is_enclosed | (token.is_number << 1) | (is_opaque << 2) |
+                          (token.keyword.has_value() << 3) | (token.element_kind.has_value() << 4);
+    signature_.push_back(static_cast<char>(token.kind));
+    signature_.push_back(static_cast<char>(flags));
+    if (token.keyword) append_integer(token.keyword->id);
+    if (token.element_kind) signature_.push_back(static_cast<char>(*token.element_kind));
+    if (is_bracket_token(token)) append_integer(static_cast<uint32_t>(token.matching_bracket));
+    if (!is_opaque) {
+      append_integer(static_cast<uint32_t>(token.value.size()));
+      signature_.append(token.value);
+    }
+  }
+
+  // Returns the index of the token that contains the position
+  [[nodiscard]] static size_t token_at(std::span<const Token> tokens, const size_t position) {
+    const auto it = std::ranges::upper_bound(tokens, position, {}, &Token::position);
+    return static_cast<size_t>(it - tokens.begin()) - 1;
+  }
+
+  // Elements of opaque tokens must cover them as a whole, and elements of other tokens must not
+  // depend on opaque tokens, so that the shape holds for all inputs with the same signature.
+  template <typename Elements>
+  [[nodiscard]] static Shape trace(std::string_view input, std::span<Token> tokens,
+                                   const Elements& elements) {
+    using enum ShapeElement::Source;
+    Shape shape;
+    for (const auto& element : elements) {
+      std::string_view value{element.value};
+      if (value.empty() || element.position >= input.size()) return shape;
+
+      ShapeElement traced{.kind = element.kind, .source = Literal};
+      traced.first = static_cast<uint32_t>(token_at(tokens, element.position));
+      const auto& first = tokens[traced.first];
+      traced.offset = static_cast<uint32_t>(element.position - first.position);
+
+      if (input.substr(element.position).starts_with(value)) {
+        const size_t end = element.position + value.size();
+        traced.source = Slice;
+        traced.last = static_cast<uint32_t>(token_at(tokens, end - 1));
+        const auto& last = tokens[traced.last];
+        traced.end_offset = static_cast<uint32_t>(last.position + last.value.size() - end);
+        if ((is_opaque_token(first) && traced.offset) ||
+            (is_opaque_token(last) && traced.end_offset)) {
+          return shape;
+        }
+      } else if (traced.offset == 0 && trace_value(tokens, value, traced)) {
+        // built from a range of tokens
+      } else if (!is_opaque_token(first)) {
+        traced.literal = value;  // e.g. a keyword as it is spelled in the table
+      } else {
+        return shape;
+      }
+
+      shape.elements.push_back(std::move(traced));
+    }
+    shape.is_replayable = true;
+    return shape;
+  }
+
+  [[nodiscard]] static bool trace_value(std::span<Token> tokens, std::string_view value,
+                                        ShapeElement& traced) {
+    using enum ShapeElement::Source;
+    for (size_t last = traced.first + 1; last <= tokens.size(); ++last) {
+      const auto range = tokens.subspan(traced.first, last - traced.first);
+      for (const auto source : {Value, ValueWithDelimiters}) {
+        const auto keep = source == Value ? KeepDelimiters::No : KeepDelimiters::Yes;
+        if (build_element_value(range, keep) == value) {
+          traced.source = source;
+          traced.last = static_cast<uint32_t>(last);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  size_t capacity_;
+  std::string signature_;
+  std::unordered_map<std::string, Shape, StringHash, std::equal_to<>> shapes_;
+};
+
+}  // namespace anitomy::detail
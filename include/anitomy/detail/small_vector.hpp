@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace anitomy::detail {
+
+// Stores up to `N` items inline, and all of them on the heap once there are more. Items must be
+// default-constructible, as the inline storage is always constructed.
+template <typename T, size_t N>
+class SmallVector final {
+public:
+  [[nodiscard]] constexpr T* data() noexcept {
+    return heap_.empty() ? inline_.data() : heap_.data();
+  }
+
+  [[nodiscard]] constexpr const T* data() const noexcept {
+    return heap_.empty() ? inline_.data() : heap_.data();
+  }
+
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    return size_;
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  [[nodiscard]] constexpr T& operator[](const size_t i) noexcept {
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr const T& operator[](const size_t i) const noexcept {
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr T* begin() noexcept {
+    return data();
+  }
+
+  [[nodiscard]] constexpr T* end() noexcept {
+    return data() + size_;
+  }
+
+  [[nodiscard]] constexpr const T* begin() const noexcept {
+    return data();
+  }
+
+  [[nodiscard]] constexpr const T* end() const noexcept {
+    return data() + size_;
+  }
+
+  constexpr void push_back(T value) {
+    if (heap_.empty() && size_ < N) {
+      inline_[size_++] = std::move(value);
+      return;
+    }
+    if (heap_.empty()) {
+      heap_.reserve(N * 2);
+      for (auto& item : std::span{inline_}.first(size_)) heap_.push_back(std::move(item));
+    }
+    heap_.push_back(std::move(value));
+    ++size_;
+  }
+
+  // Moves the items back inline if they fit, so that the storage can be reused
+  constexpr void resize(const size_t size) {
+    if (size <= N) {
+      if (!heap_.empty()) {
+        for (size_t i = 0; i < size; ++i) inline_[i] = std::move(heap_[i]);
+        heap_.clear();
+      }
+    } else {
+      if (heap_.empty()) {
+        heap_.reserve(size);
+        for (auto& item : std::span{inline_}.first(size_)) heap_.push_back(std::move(item));
+      }
+      heap_.resize(size);
+    }
+    size_ = size;
+  }
+
+  constexpr void clear() noexcept {
+    heap_.clear();
+    size_ = 0;
+  }
+
+private:
+  std::array<T, N> inline_{};
+  std::vector<T> heap_;
+  size_t size_ = 0;
+};
+
+}  // namespace anitomy::detail
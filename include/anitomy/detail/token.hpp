@@ -1,7 +1,7 @@
 #pragma once
 
 #include <optional>
-#include <string>
+#include <string_view>
 
 #include <anitomy/detail/keyword.hpp>
 #include <anitomy/element.hpp>
@@ -18,14 +18,27 @@ enum class TokenKind {
 
 struct Token {
   TokenKind kind;
-  std::string value;
+  std::string_view value;    // slice of the input string
   std::optional<Keyword> keyword;
   std::optional<ElementKind> element_kind;
   size_t position = 0;       // index in input string
   bool is_enclosed = false;  // token is enclosed in brackets
   bool is_number = false;    // all characters in `value` are digits
+
+  // Brackets only
+  size_t matching_bracket = std::string_view::npos;  // index of the matching bracket token
+  size_t depth = 0;                                  // number of enclosing bracket pairs
 };
 
+constexpr bool has_matching_bracket(const Token& token) noexcept {
+  return token.matching_bracket != std::string_view::npos;
+}
+
+// Returns the position of a slice of the token value in the input string
+constexpr size_t position_of(const Token& token, std::string_view slice) noexcept {
+  return token.position + static_cast<size_t>(slice.data() - token.value.data());
+}
+
 constexpr bool is_identified_token(const Token& token) noexcept {
   return token.element_kind.has_value();
 };
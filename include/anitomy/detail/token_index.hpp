@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <anitomy/detail/keyword.hpp>
+#include <anitomy/detail/token.hpp>
+#include <anitomy/detail/util.hpp>
+
+namespace anitomy::detail {
+
+// Positions of tokens that the element parsers look for, so that the rules can query them instead
+// of scanning the whole token list. Built once after tokenization.
+//
+// Only static properties of the tokens are indexed. Tokens may be identified as elements in the
+// meantime, so callers still need to check `is_free_token` where it matters.
+template <typename Allocator = std::allocator<char>>
+class TokenIndex final {
+public:
+  using indices_type = std::vector<size_t, rebind_alloc_t<Allocator, size_t>>;
+
+  TokenIndex() noexcept = default;
+
+  explicit TokenIndex(const Allocator& allocator) noexcept
+      : numbers_{allocator},
+        keywords_{allocator},
+        next_non_delimiter_{allocator},
+        prev_non_delimiter_{allocator} {
+  }
+
+  inline void build(std::span<const Token> tokens) noexcept {
+    const size_t size = tokens.size();
+
+    numbers_.clear();
+    keywords_.clear();
+    keyword_offsets_.fill(0);
+    next_non_delimiter_.resize(size + 1);
+    prev_non_delimiter_.resize(size + 1);
+
+    // Keywords are bucketed by kind with a counting sort
+    for (size_t i = 0; i < size; ++i) {
+      if (is_numeric_token(tokens[i])) numbers_.push_back(i);
+      if (tokens[i].keyword) ++keyword_offsets_[bucket(tokens[i].keyword->kind) + 1];
+    }
+    for (size_t kind = 1; kind < keyword_offsets_.size(); ++kind) {
+      keyword_offsets_[kind] += keyword_offsets_[kind - 1];
+    }
+    keywords_.resize(keyword_offsets_.back());
+    auto offsets = keyword_offsets_;
+    for (size_t i = 0; i < size; ++i) {
+      if (tokens[i].keyword) keywords_[offsets[bucket(tokens[i].keyword->kind)]++] = i;
+    }
+
+    // Delimiter runs are skipped in a single step
+    next_non_delimiter_[size] = size;
+    for (size_t i = size, next = size; i-- > 0;) {
+      next_non_delimiter_[i] = next;
+      if (is_not_delimiter_token(tokens[i])) next = i;
+    }
+    for (size_t i = 0, prev = size; i <= size; ++i) {
+      prev_non_delimiter_[i] = prev;
+      if (i < size && is_not_delimiter_token(tokens[i])) prev = i;
+    }
+  }
+
+  // Indices of numeric tokens, in order
+  [[nodiscard]] constexpr std::span<const size_t> numbers() const noexcept {
+    return numbers_;
+  }
+
+  // Indices of tokens with a keyword of the given kind, in order
+  [[nodiscard]] constexpr std::span<const size_t> keywords(const KeywordKind kind) const noexcept {
+    const size_t first = keyword_offsets_[bucket(kind)];
+    const size_t last = keyword_offsets_[bucket(kind) + 1];
+    return std::span{keywords_}.subspan(first, last - first);
+  }
+
+  // Index of the first non-delimiter token after `i`, or the number of tokens if there is none.
+  // `i` can be the number of tokens (i.e. past the end) for this and `prev_non_delimiter`.
+  [[nodiscard]] constexpr size_t next_non_delimiter(const size_t i) const noexcept {
+    return next_non_delimiter_[i];
+  }
+
+  // Index of the last non-delimiter token before `i`, or the number of tokens if there is none
+  [[nodiscard]] constexpr size_t prev_non_delimiter(const size_t i) const noexcept {
+    return prev_non_delimiter_[i];
+  }
+
+private:
+  static constexpr size_t keyword_kind_count = static_cast<size_t>(KeywordKind::Volume) + 1;
+
+  [[nodiscard]] static constexpr size_t bucket(const KeywordKind kind) noexcept {
+    return static_cast<size_t>(kind);
+  }
+
+  indices_type numbers_;
+  indices_type keywords_;
+  std::array<size_t, keyword_kind_count + 1> keyword_offsets_{};
+  indices_type next_non_delimiter_;
+  indices_type prev_non_delimiter_;
+};
+
+}  // namespace anitomy::detail
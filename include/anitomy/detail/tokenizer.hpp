@@ -1,9 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
 #include <optional>
-#include <ranges>
-#include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
@@ -11,6 +10,7 @@
 #include <anitomy/detail/bracket.hpp>
 #include <anitomy/detail/delimiter.hpp>
 #include <anitomy/detail/keyword.hpp>
+#include <anitomy/detail/profile.hpp>
 #include <anitomy/detail/token.hpp>
 #include <anitomy/detail/unicode.hpp>
 #include <anitomy/detail/util.hpp>
@@ -18,15 +18,27 @@
 
 namespace anitomy::detail {
 
+template <typename Allocator = std::allocator<char>>
 class Tokenizer final {
 public:
+  using tokens_type = std::vector<Token, rebind_alloc_t<Allocator, Token>>;
+
   // Input must be UTF-8 encoded and should be in composed form (NFC/NFKC).
-  // UTF-32 is used internally for easier processing.
-  constexpr explicit Tokenizer(std::string_view input) noexcept
-      : input_{unicode::utf8_to_utf32(input)}, view_{input_} {
+  // Tokens refer to slices of the input, so the input must outlive them.
+  constexpr Tokenizer() noexcept = default;
+
+  constexpr explicit Tokenizer(std::string_view input, const Allocator& allocator = {}) noexcept
+      : view_{input}, tokens_{allocator} {
+  }
+
+  // Starts over with a new input, keeping the capacity of the token buffer.
+  constexpr void reset(std::string_view input) noexcept {
+    view_ = input;
+    tokens_.clear();
   }
 
   constexpr void tokenize(const Options& options) noexcept {
+    ANITOMY_PROFILE_SCOPE(Tokenize);
     while (auto token = next_token()) {
       tokens_.emplace_back(*token);
     }
@@ -78,14 +90,34 @@ private:
   }
 
   constexpr void process_tokens() noexcept {
+    static constexpr auto npos = std::string_view::npos;
+
     int bracket_level = 0;
     size_t position = 0;
 
-    for (auto& token : tokens_) {
+    // Unmatched open brackets form a stack, which is linked through their `matching_bracket`
+    // fields until they are matched, so that no extra storage is needed.
+    size_t open_bracket = npos;
+    size_t depth = 0;
+
+    for (size_t i = 0; i < tokens_.size(); ++i) {
+      auto& token = tokens_[i];
+
       if (token.kind == TokenKind::OpenBracket) {
         bracket_level += 1;
+        token.matching_bracket = open_bracket;
+        token.depth = depth++;
+        open_bracket = i;
       } else if (token.kind == TokenKind::CloseBracket) {
         bracket_level -= 1;
+        if (open_bracket != npos) {
+          auto& open_token = tokens_[open_bracket];
+          token.matching_bracket = open_bracket;
+          token.depth = --depth;
+          open_bracket = std::exchange(open_token.matching_bracket, i);
+        } else {
+          token.depth = depth;
+        }
       } else {
         token.is_enclosed = bracket_level > 0;
       }
@@ -97,6 +129,10 @@ private:
         token.is_number = std::ranges::all_of(token.value, is_digit);
       }
     }
+
+    while (open_bracket != npos) {
+      open_bracket = std::exchange(tokens_[open_bracket].matching_bracket, npos);
+    }
   }
 
   [[nodiscard]] static constexpr bool is_text(const char32_t ch) noexcept {
@@ -111,60 +147,68 @@ private:
     return view_.empty();
   }
 
+  // Code points are decoded only at non-ASCII lead bytes, which is rare for most filenames.
+  [[nodiscard]] constexpr std::pair<char32_t, size_t> peek_code_point(
+      const size_t offset = 0) const noexcept {
+    const auto view = view_.substr(offset);
+    if (const auto byte = static_cast<unicode::byte_t>(view.front()); byte < 0x80) {
+      return {byte, 1};
+    }
+    const auto result = unicode::utf8::decode(view);
+    return {result.code_point, static_cast<size_t>(result.next - view.begin())};
+  }
+
   [[nodiscard]] constexpr char32_t peek() const noexcept {
-    return view_.front();
+    return peek_code_point().first;
   }
 
-  [[nodiscard]] constexpr std::u32string_view peek(const size_t n) const noexcept {
-    return view_.substr(0, n);
+  [[nodiscard]] constexpr std::string_view take(const size_t n) noexcept {
+    const auto view = view_.substr(0, n);
+    view_.remove_prefix(view.size());
+    return view;
   }
 
-  [[nodiscard]] constexpr std::string take(const size_t n = 1) noexcept {
-    auto view = view_ | std::views::take(n);
-    view_.remove_prefix(n);
-    return unicode::utf32_to_utf8(view);
+  [[nodiscard]] constexpr std::string_view take() noexcept {
+    return take(peek_code_point().second);
   }
 
-  [[nodiscard]] constexpr std::string take_text() noexcept {
-    auto text = view_ | std::views::take_while(is_text);
-    auto n = std::ranges::distance(text);
+  [[nodiscard]] constexpr std::string_view take_text() noexcept {
+    size_t n = 0;
+    while (n < view_.size()) {
+      const auto [ch, length] = peek_code_point(n);
+      if (!is_text(ch)) break;
+      n += length;
+    }
     return take(n);
   }
 
-  [[nodiscard]] inline std::pair<std::string, Keyword> take_keyword() noexcept {
-    static constexpr auto count_candidates = [](std::string_view prefix) {
-      static const auto keys = keywords | std::views::keys;
-      return std::ranges::count_if(keys, [&prefix](std::string_view keyword) {
-        return std::ranges::starts_with(keyword, prefix, equal_to);
-      });
+  [[nodiscard]] inline std::pair<std::string_view, Keyword> take_keyword() noexcept {
+    const auto is_keyword_boundary = [this](const size_t offset) {
+      return offset == view_.size() || is_word_boundary(peek_code_point(offset).first);
     };
 
-    static constexpr auto is_keyword_boundary = [](std::u32string_view view) {
-      return view.empty() || is_word_boundary(view.front());
-    };
-
-    std::string key;
+    // Walk the trie until there are no more candidates, remembering the longest match
+    const auto* node = keyword_trie.root();
+    const Keyword* keyword = nullptr;
+    size_t n = 0;
 
-    for (size_t n = 1; n <= view_.size(); ++n) {
-      auto prefix = unicode::utf32_to_utf8(peek(n));
-      if (keywords.contains(prefix)) key = prefix;
-      if (count_candidates(prefix) > 0) continue;
-      if (key.empty()) break;
+    for (size_t i = 0; i < view_.size();) {
+      if (node = keyword_trie.next(node, view_[i++]); !node) break;
+      if (const auto match = keyword_trie.keyword(node)) {
+        keyword = match;
+        n = i;
+      }
     }
 
-    if (key.empty()) return {};
-
-    const size_t n = key.size();
-    const auto keyword = keywords[key];
+    if (!keyword) return {};
 
-    if (keyword.is_bounded() && !is_keyword_boundary(view_.substr(n))) return {};
+    if (keyword->is_bounded() && !is_keyword_boundary(n)) return {};
 
-    return std::make_pair(take(n), keyword);
+    return std::make_pair(take(n), *keyword);
   }
 
-  std::u32string input_;
-  std::u32string_view view_;
-  std::vector<Token> tokens_;
+  std::string_view view_;
+  tokens_type tokens_;
 };
 
 }  // namespace anitomy::detail
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <charconv>
+#include <cstdint>
 #include <fstream>
+#include <memory>
 #include <string_view>
 #include <unordered_map>
 
@@ -51,6 +53,17 @@ constexpr bool is_xdigit(const char ch) noexcept {
   return ('0' <= ch && ch <= '9') || ('A' <= ch && ch <= 'F') || ('a' <= ch && ch <= 'f');
 }
 
+// FNV-1a, which is the same on all platforms and in all runs (unlike `std::hash`), so that it can
+// be persisted
+constexpr uint64_t hash_bytes(const std::string_view bytes,
+                              uint64_t hash = 0xcbf29ce484222325) noexcept {
+  for (const char ch : bytes) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
 constexpr int to_int(const std::string_view str) noexcept {
   int value{0};
   std::from_chars(str.data(), str.data() + str.size(), value, 10);
@@ -84,6 +97,30 @@ inline bool read_file(const std::string& path, std::string& output) {
   return file.good();
 }
 
+// Returns the leading part of the text that is at least `size` bytes long (unless the text is
+// shorter) and ends with a line break, so that the text can be cut into chunks of whole lines.
+constexpr std::string_view take_lines(const std::string_view text, const size_t size) noexcept {
+  if (size >= text.size()) return text;
+  const size_t end = text.find('\n', size ? size - 1 : 0);
+  return end != std::string_view::npos ? text.substr(0, end + 1) : text;
+}
+
+// Calls `fn(line)` for each line of the text, without the line break. A final line break does not
+// start another line.
+template <typename Fn>
+constexpr void for_each_line(std::string_view text, Fn&& fn) {
+  while (!text.empty()) {
+    const size_t end = text.find('\n');
+    auto line = text.substr(0, end);
+    text.remove_prefix(end != std::string_view::npos ? end + 1 : text.size());
+    if (line.ends_with('\r')) line.remove_suffix(1);
+    fn(line);
+  }
+}
+
+template <typename Allocator, typename T>
+using rebind_alloc_t = std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
 template <typename It, typename Predicate>
 constexpr std::vector<It> find_all_if(It first, It last, Predicate p) {
   std::vector<It> found;
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/version.hpp>
+#include <anitomy/detail/cli/output.hpp>
+#include <anitomy/detail/keyword.hpp>
+#include <anitomy/detail/mapped_file.hpp>
+#include <anitomy/detail/options.hpp>
+#include <anitomy/detail/util.hpp>
+
+namespace anitomy {
+
+// Keeps the results of parsed inputs in a file, so that a later run can load them instead of
+// parsing the same inputs again. The file is append-only, and integers are little-endian:
+//
+//   file   = header record*
+//   header = magic:u8[8] format:u32 version:u64 keywords:u64
+//   record = input:string options:u32 elements
+//
+// where `elements` is a record of the binary output format (see `detail/cli/output.hpp`), and
+// `version` and `keywords` are hashes of the library version and the keyword table. Results are
+// discarded when either of them changes, and a partially written record at the end of the file
+// (e.g. after a crash) is dropped.
+//
+// The file is memory-mapped, and only the location of each record is read when it is opened.
+// Records are decoded when they are looked up. Not thread-safe.
+class DiskCache final {
+public:
+  DiskCache() = default;
+
+  explicit DiskCache(const std::string& path) {
+    open(path);
+  }
+
+  DiskCache(const DiskCache&) = delete;
+  DiskCache& operator=(const DiskCache&) = delete;
+
+  ~DiskCache() {
+    close();
+  }
+
+  // Creates the file if it does not exist. Files that were not written by a cache (other than empty
+  // files), and files that cannot be read, are not touched.
+  inline bool open(const std::string& path) {
+    close();
+
+    std::error_code error;
+    const auto type = std::filesystem::status(path, error).type();
+    if (type == std::filesystem::file_type::not_found) {
+      if (!write_file(path, header(), "wb")) return false;
+    } else if (type != std::filesystem::file_type::regular) {
+      return false;  // e.g. a directory or a pipe
+    }
+
+    if (!file_.open(path)) {
+      return false;
+    } else if (file_.view().empty()) {
+      file_.close();
+      if (!write_file(path, header(), "wb") || !file_.open(path)) return false;
+    } else if (!file_.view().starts_with(magic)) {
+      file_.close();
+      return false;
+    } else if (!file_.view().starts_with(header())) {
+      file_.close();  // written by another version, or with other keywords
+      if (!write_file(path, header(), "wb") || !file_.open(path)) return false;
+    }
+
+    const size_t end = index(header_size);
+    if (end < file_.view().size()) {
+      file_.close();
+      std::error_code error;
+      std::filesystem::resize_file(path, end, error);
+      if (error || !file_.open(path)) return false;
+    }
+
+    path_ = path;
+    return true;
+  }
+
+  // Writes the records that were appended since the last flush
+  inline void close() {
+    flush();
+    file_.close();
+    index_.clear();
+    path_.clear();
+  }
+
+  [[nodiscard]] constexpr bool is_open() const noexcept {
+    return file_.is_open();
+  }
+
+  // Number of inputs that have a result, for any options
+  [[nodiscard]] inline size_t size() const noexcept {
+    return index_.size();
+  }
+
+  [[nodiscard]] inline std::optional<std::vector<Element>> find(std::string_view input,
+                                                                const Options& options = {}) const {
+    const uint32_t fingerprint = detail::fingerprint(options);
+    const auto it = index_.find(key(input, fingerprint));
+    if (it == index_.end()) return std::nullopt;
+
+    auto data = record(it->second);
+    std::string_view record_input;
+    uint32_t record_fingerprint = 0;
+    std::vector<Element> elements;
+    if (!detail::read_binary_string(data, record_input) || record_input != input ||
+        !detail::read_binary_integer(data, record_fingerprint) ||
+        record_fingerprint != fingerprint || !detail::read_binary(data, elements)) {
+      return std::nullopt;
+    }
+    return elements;
+  }
+
+  // Returns the cached result of the input, or parses it and appends the result to the file
+  [[nodiscard]] inline std::vector<Element> parse(std::string_view input,
+                                                  const Options& options = {}) {
+    if (auto elements = find(input, options)) return std::move(*elements);
+
+    auto elements = anitomy::parse(input, options);
+    if (!is_open()) return elements;
+
+    const uint32_t fingerprint = detail::fingerprint(options);
+    index_[key(input, fingerprint)] = file_.view().size() + pending_.size();
+    detail::write_binary_string(input, pending_);
+    detail::write_binary_integer(fingerprint, pending_);
+    detail::write_binary(elements, pending_);
+    if (pending_.size() >= flush_size) flush();
+
+    return elements;
+  }
+
+  // Writes the records that were appended since the last flush, and maps them along with the rest
+  inline void flush() {
+    if (pending_.empty() || !is_open()) return;
+    // The file is not kept open for writing, because it cannot be mapped meanwhile on all platforms
+    const bool success = write_file(path_, pending_, "ab");
+    pending_.clear();
+    if (!success || !file_.open(path_)) close();
+  }
+
+private:
+  static constexpr std::string_view magic{"ANITOMY\0", 8};
+  static constexpr uint32_t format = 2;
+  static constexpr size_t header_size = magic.size() + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+  static constexpr size_t flush_size = 1 << 20;
+
+  [[nodiscard]] static std::string header() {
+    std::string header{magic};
+    detail::write_binary_integer(format, header);
+    detail::write_binary_integer(detail::hash_bytes(version()), header);
+    detail::write_binary_integer(detail::keyword_table_hash, header);
+    return header;
+  }
+
+  [[nodiscard]] static constexpr uint64_t key(std::string_view input,
+                                              const uint32_t fingerprint) noexcept {
+    return detail::hash_bytes(input) ^ (uint64_t{fingerprint} << 32);
+  }
+
+  static bool write_file(const std::string& path, std::string_view data, const char* mode) {
+    std::FILE* file = std::fopen(path.c_str(), mode);
+    if (!file) return false;
+    const bool success = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && success;
+  }
+
+  // Indexes the records from the offset, and returns the end of the last complete record. Later
+  // records of the same input replace earlier ones.
+  inline size_t index(size_t offset) {
+    const auto view = file_.view();
+    while (offset < view.size()) {
+      auto data = view.substr(offset);
+      std::string_view input;
+      uint32_t fingerprint = 0;
+      uint32_t size = 0;
+      if (!detail::read_binary_string(data, input) ||
+          !detail::read_binary_integer(data, fingerprint) ||
+          !detail::read_binary_integer(data, size) || data.size() < size) {
+        break;
+      }
+      index_[key(input, fingerprint)] = offset;
+      offset = view.size() - data.size() + size;
+    }
+    return offset;
+  }
+
+  // Returns the data from the offset until the end of the file, or of the pending records
+  [[nodiscard]] inline std::string_view record(const size_t offset) const noexcept {
+    const auto view = file_.view();
+    if (offset < view.size()) return view.substr(offset);
+    return std::string_view{pending_}.substr(offset - view.size());
+  }
+
+  detail::MappedFile file_;
+  std::string path_;
+  std::string pending_;                         // appended records that are not written yet
+  std::unordered_map<uint64_t, size_t> index_;  // offsets of records in the file, or after it
+};
+
+}  // namespace anitomy
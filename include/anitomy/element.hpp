@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
 #include <string>
 
 namespace anitomy {
@@ -27,10 +31,67 @@ enum class ElementKind {
   Year,
 };
 
-struct Element {
+// A set of element kinds, e.g. `{ElementKind::Title, ElementKind::Episode}`
+struct ElementSet final {
+  constexpr ElementSet() noexcept = default;
+
+  constexpr ElementSet(std::initializer_list<ElementKind> kinds) noexcept {
+    for (const auto kind : kinds) insert(kind);
+  }
+
+  [[nodiscard]] static constexpr ElementSet all() noexcept {
+    ElementSet set;
+    set.bits = (bit(ElementKind::Year) << 1) - 1;
+    return set;
+  }
+
+  constexpr void insert(const ElementKind kind) noexcept {
+    bits |= bit(kind);
+  }
+
+  constexpr void erase(const ElementKind kind) noexcept {
+    bits &= ~bit(kind);
+  }
+
+  [[nodiscard]] constexpr bool contains(const ElementKind kind) const noexcept {
+    return (bits & bit(kind)) != 0;
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return bits == 0;
+  }
+
+  bool operator==(const ElementSet&) const = default;
+
+  // Has a bit for each kind, by the value of the kind. Public, so that options can be template
+  // arguments (see `anitomy::parse<Options{...}>`).
+  uint32_t bits = 0;
+
+private:
+  [[nodiscard]] static constexpr uint32_t bit(const ElementKind kind) noexcept {
+    return uint32_t{1} << static_cast<uint32_t>(kind);
+  }
+};
+
+// Element values can be allocated with a custom allocator (e.g. to parse a batch of inputs into a
+// `std::pmr::monotonic_buffer_resource` and release them all at once).
+template <typename Allocator = std::allocator<char>>
+struct BasicElement {
+  using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+
   ElementKind kind;
-  std::string value;
+  string_type value;
   size_t position;
+
+  bool operator==(const BasicElement&) const = default;
 };
 
+using Element = BasicElement<>;
+
+namespace pmr {
+
+using Element = BasicElement<std::pmr::polymorphic_allocator<char>>;
+
+}  // namespace pmr
+
 }  // namespace anitomy
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <anitomy/detail/keyword.hpp>
+
+namespace anitomy {
+
+// Identifies a keyword by its index in the keyword table. IDs are the same for all inputs, so they
+// can be compared instead of values, but they may change between versions of the library.
+using KeywordId = uint16_t;
+
+inline constexpr size_t keyword_count = detail::keywords.size();
+
+// Returns the ID of the keyword that is spelled exactly as the value, such as the value of an
+// element that was parsed with `Options::canonical_keywords` (e.g. `mkv`, but not `MKV`).
+[[nodiscard]] constexpr std::optional<KeywordId> find_keyword(std::string_view value) noexcept {
+  const auto* keyword = detail::keyword_trie.find(value);
+  if (!keyword || detail::keyword_value(*keyword) != value) return std::nullopt;
+  return keyword->id;
+}
+
+// Returns the keyword as it is spelled in the table. The value has static storage duration.
+[[nodiscard]] constexpr std::string_view keyword_value(const KeywordId id) noexcept {
+  return detail::keywords[id].first;
+}
+
+}  // namespace anitomy
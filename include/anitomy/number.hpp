@@ -0,0 +1,78 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+#include <anitomy/detail/matcher.hpp>
+#include <anitomy/detail/util.hpp>
+
+namespace anitomy {
+
+// The value of an episode, season, volume or year element (e.g. `01`, `07.5`, `4a`)
+struct Number {
+  int value = 0;
+  bool is_half = false;  // `.5`
+  char suffix = 0;       // part of a partial episode (e.g. `a` in `4a`)
+
+  bool operator==(const Number&) const = default;
+};
+
+// A range of numbers (e.g. `01-02`), which is a single number if `first == last`
+struct NumberRange {
+  Number first;
+  Number last;
+
+  bool operator==(const NumberRange&) const = default;
+};
+
+// The value of a video resolution element (e.g. `1080p`, `1920x1080`). Unknown parts are zero.
+struct VideoResolution {
+  int width = 0;
+  int height = 0;
+  char scan = 0;  // `p` (progressive) or `i` (interlaced)
+
+  bool operator==(const VideoResolution&) const = default;
+};
+
+// Returns the number that the value of an element stands for, if it is in one of the forms that the
+// parser produces
+[[nodiscard]] constexpr std::optional<Number> to_number(std::string_view value) noexcept {
+  detail::Matcher m{value};
+  const auto digits = m.take_digits(1, 9);
+  if (digits.empty()) return std::nullopt;
+  Number number{.value = detail::to_int(digits)};
+  if (m.skip(".5")) {
+    number.is_half = true;
+  } else if (detail::is_alpha(m.peek())) {
+    number.suffix = m.peek();
+    m.skip();
+  }
+  if (!m.is_eof()) return std::nullopt;
+  return number;
+}
+
+// Returns the width, height and scan type of a video resolution (e.g. `1080p`, `1920x1080`, `4K`)
+[[nodiscard]] constexpr std::optional<VideoResolution> to_video_resolution(
+    std::string_view value) noexcept {
+  if (value == "4K" || value == "4k") return VideoResolution{.width = 3840, .height = 2160};
+
+  detail::Matcher m{value};
+  const auto first = m.take_digits(3, 4);
+  if (first.empty()) return std::nullopt;
+
+  VideoResolution resolution{.height = detail::to_int(first)};
+  if (m.skip('x') || m.skip('X') || m.skip("×")) {
+    const auto second = m.take_digits(3, 4);
+    if (second.empty()) return std::nullopt;
+    resolution.width = resolution.height;
+    resolution.height = detail::to_int(second);
+  }
+  if (m.peek() == 'i' || m.peek() == 'p' || m.peek() == 'I' || m.peek() == 'P') {
+    resolution.scan = detail::to_lower(m.peek());
+    m.skip();
+  }
+  if (!m.is_eof()) return std::nullopt;
+  return resolution;
+}
+
+}  // namespace anitomy
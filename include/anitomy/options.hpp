@@ -1,5 +1,9 @@
 #pragma once
 
+#include <stop_token>
+
+#include <anitomy/element.hpp>
+
 namespace anitomy {
 
 struct Options {
@@ -12,6 +16,29 @@ struct Options {
   bool parse_title = true;
   bool parse_video_resolution = true;
   bool parse_year = true;
+
+  // Values of elements that come from keywords (e.g. audio and video terms, sources, file
+  // extensions) are spelled as in the keyword table, regardless of their case in the input (e.g.
+  // `mkv` for `MKV`). The input can still be recovered from the position of the element, as the
+  // length is the same. See `anitomy::find_keyword`.
+  bool canonical_keywords = false;
+
+  // Kinds of elements to return. Parsing stops after the last stage that can find elements of
+  // these kinds, and elements of other kinds are not allocated, so asking for fewer kinds is
+  // faster. The elements are the same as the elements of these kinds when all kinds are requested.
+  ElementSet kinds = ElementSet::all();
+};
+
+struct EngineOptions {
+  // Number of distinct token shapes whose parse is remembered, so that inputs of the same shape are
+  // not run through the rules again (0 disables it). See `detail/shape.hpp`.
+  size_t shape_capacity = 0;
+};
+
+struct BatchOptions {
+  size_t thread_count = 0;  // 0 uses all available hardware threads
+  size_t chunk_size = 256;  // number of inputs that a thread claims at once
+  std::stop_token stop_token{};
 };
 
 }  // namespace anitomy
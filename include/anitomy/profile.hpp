@@ -0,0 +1,28 @@
+#pragma once
+
+#include <anitomy/detail/profile.hpp>
+
+namespace anitomy {
+
+using Profile = detail::Profile;
+using ProfileCounter = detail::ProfileCounter;
+using ProfileStage = detail::ProfileStage;
+
+#ifdef ANITOMY_PROFILE
+inline constexpr bool profile_enabled = true;
+#else
+inline constexpr bool profile_enabled = false;
+#endif
+
+// Returns the time spent in each stage of the parser and the number of times that some operations
+// were performed, summed over the threads that have exited and the calling thread. The profile is
+// always empty unless `ANITOMY_PROFILE` is defined.
+[[nodiscard]] inline Profile profile() noexcept {
+  return detail::collect_profile();
+}
+
+inline void reset_profile() noexcept {
+  detail::reset_profile();
+}
+
+}  // namespace anitomy
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/detail/element.hpp>
+#include <anitomy/detail/small_vector.hpp>
+#include <anitomy/number.hpp>
+
+namespace anitomy {
+
+// Holds the elements of an input in position order, like `std::vector<Element>`, and also indexes
+// them by kind, so that finding elements of a kind does not need to go through all of them. Up to
+// `inline_capacity` elements are stored without allocating.
+//
+// Episode, season, volume, year and video resolution values are also decoded into numbers once, so
+// that they can be used without converting the strings again.
+class Result final {
+public:
+  static constexpr size_t inline_capacity = 16;
+
+  Result() noexcept = default;
+
+  explicit Result(std::span<const Element> elements) {
+    assign(elements);
+  }
+
+  // Replaces the elements, reusing the storage of the previous ones
+  inline void assign(std::span<const Element> elements) {
+    elements_.resize(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+      elements_[i].kind = elements[i].kind;
+      elements_[i].value.assign(elements[i].value);
+      elements_[i].position = elements[i].position;
+    }
+    build_index();
+  }
+
+  [[nodiscard]] constexpr size_t size() const noexcept {
+    return elements_.size();
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return elements_.empty();
+  }
+
+  [[nodiscard]] constexpr const Element& operator[](const size_t i) const noexcept {
+    return elements_[i];
+  }
+
+  [[nodiscard]] constexpr const Element* begin() const noexcept {
+    return elements_.begin();
+  }
+
+  [[nodiscard]] constexpr const Element* end() const noexcept {
+    return elements_.end();
+  }
+
+  [[nodiscard]] constexpr std::span<const Element> elements() const noexcept {
+    return {elements_.data(), elements_.size()};
+  }
+
+  [[nodiscard]] constexpr bool contains(const ElementKind kind) const noexcept {
+    return count(kind) != 0;
+  }
+
+  [[nodiscard]] constexpr size_t count(const ElementKind kind) const noexcept {
+    const auto i = static_cast<size_t>(kind);
+    return offsets_[i + 1] - offsets_[i];
+  }
+
+  // Returns the first element of the kind, or null if there is none
+  [[nodiscard]] constexpr const Element* first(const ElementKind kind) const noexcept {
+    return contains(kind) ? &elements_[order_[offsets_[static_cast<size_t>(kind)]]] : nullptr;
+  }
+
+  // Returns the value of the first element of the kind, or an empty string if there is none
+  [[nodiscard]] constexpr std::string_view value(const ElementKind kind) const noexcept {
+    const auto* element = first(kind);
+    return element ? std::string_view{element->value} : std::string_view{};
+  }
+
+  // Returns the elements of the kind, in position order
+  [[nodiscard]] auto all(const ElementKind kind) const noexcept {
+    const auto i = static_cast<size_t>(kind);
+    const auto indexes = std::span{order_.data() + offsets_[i], order_.data() + offsets_[i + 1]};
+    return indexes | std::views::transform(
+                         [this](const uint32_t j) -> const Element& { return elements_[j]; });
+  }
+
+  // Returns the number of the element, if it is an episode, season, volume or year
+  [[nodiscard]] constexpr std::optional<Number> number(const size_t i) const noexcept {
+    return numbers_[i];
+  }
+
+  // Returns the number of the first element of the kind
+  [[nodiscard]] constexpr std::optional<Number> number(const ElementKind kind) const noexcept {
+    return contains(kind) ? numbers_[order_[offsets_[static_cast<size_t>(kind)]]] : std::nullopt;
+  }
+
+  // Returns the numbers of the first and the last element of the kind (e.g. `1` and `2` for
+  // episode `01-02`)
+  [[nodiscard]] constexpr std::optional<NumberRange> range(const ElementKind kind) const noexcept {
+    if (!contains(kind)) return std::nullopt;
+    const auto i = static_cast<size_t>(kind);
+    const auto& first = numbers_[order_[offsets_[i]]];
+    const auto& last = numbers_[order_[offsets_[i + 1] - 1]];
+    if (!first || !last) return std::nullopt;
+    return NumberRange{*first, *last};
+  }
+
+  [[nodiscard]] constexpr std::optional<int> year() const noexcept {
+    const auto number = this->number(ElementKind::Year);
+    return number ? std::optional{number->value} : std::nullopt;
+  }
+
+  // Returns the first video resolution
+  [[nodiscard]] constexpr std::optional<VideoResolution> video_resolution() const noexcept {
+    return video_resolution_;
+  }
+
+  [[nodiscard]] inline std::vector<Element> to_vector() const {
+    return {begin(), end()};
+  }
+
+  bool operator==(const Result& other) const noexcept {
+    return std::ranges::equal(elements(), other.elements());
+  }
+
+private:
+  // A counting sort of the elements by kind, which keeps them in position order within each kind
+  constexpr void build_index() {
+    offsets_.fill(0);
+    for (const auto& element : elements_) {
+      ++offsets_[static_cast<size_t>(element.kind) + 1];
+    }
+    for (size_t i = 1; i < offsets_.size(); ++i) {
+      offsets_[i] += offsets_[i - 1];
+    }
+    auto next = offsets_;
+    order_.resize(elements_.size());
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      order_[next[static_cast<size_t>(elements_[i].kind)]++] = static_cast<uint32_t>(i);
+    }
+
+    numbers_.resize(elements_.size());
+    for (size_t i = 0; i < elements_.size(); ++i) {
+      numbers_[i] = has_number(elements_[i].kind) ? to_number(elements_[i].value) : std::nullopt;
+    }
+    const auto* resolution = first(ElementKind::VideoResolution);
+    video_resolution_ = resolution ? to_video_resolution(resolution->value) : std::nullopt;
+  }
+
+  static constexpr bool has_number(const ElementKind kind) noexcept {
+    using enum ElementKind;
+    return kind == Episode || kind == Season || kind == Volume || kind == Year;
+  }
+
+  detail::SmallVector<Element, inline_capacity> elements_;
+  detail::SmallVector<uint32_t, inline_capacity> order_;  // indexes of elements, grouped by kind
+  std::array<uint32_t, detail::element_kind_count + 1> offsets_{};  // of each kind in `order_`
+  detail::SmallVector<std::optional<Number>, inline_capacity> numbers_;
+  std::optional<VideoResolution> video_resolution_;
+};
+
+// Parses the input into a `Result`. The tokens and elements are kept in a buffer for each thread in
+// between calls, so parsing an input does not allocate unless a value is too long to be stored
+// inline in its string.
+inline Result parse_result(std::string_view input, Options options = {}) {
+  thread_local Engine engine;
+  return Result{engine.parse(input, options)};
+}
+
+}  // namespace anitomy
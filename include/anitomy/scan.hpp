@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/detail/directory.hpp>
+
+namespace anitomy {
+
+struct ScanResult {
+  std::string path;
+  std::vector<Element> elements;
+};
+
+// Walks the directory tree, and parses the names of the files that have a known video extension.
+// Directories are read and names are parsed on multiple threads, as set via `batch_options`. The
+// results are ordered by path. If a stop is requested, the files that were not parsed still have
+// their path, but no elements.
+inline std::vector<ScanResult> scan(const std::string& path, Options options = {},
+                                    const BatchOptions& batch_options = {}) {
+  auto paths = detail::find_files(path, batch_options.thread_count, batch_options.stop_token,
+                                  detail::has_video_extension);
+
+  std::vector<ScanResult> results(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    results[i].path = std::move(paths[i]);
+  }
+
+  detail::parallel_for(results.size(), batch_options.thread_count, batch_options.chunk_size,
+                       batch_options.stop_token, [&](const size_t first, const size_t last) {
+                         for (size_t i = first; i < last; ++i) {
+                           results[i].elements = parse(detail::file_name(results[i].path), options);
+                         }
+                       });
+
+  return results;
+}
+
+}  // namespace anitomy
@@ -0,0 +1,30 @@
+#ifdef ANITOMY_PROFILE
+
+#include <cstdlib>
+#include <new>
+
+#include <anitomy/detail/profile.hpp>
+
+// Replaces the global allocation functions to count the number of allocations for `--profile`. This
+// is in its own translation unit, so that compilers do not see through the calls in the parser.
+// Only allocations within the stages of the parser are counted, and not the ones that the CLI makes
+// to read inputs and write results.
+
+void* operator new(size_t size) {
+  if (anitomy::detail::is_profiling_stage()) {
+    anitomy::detail::profile_count(anitomy::detail::ProfileCounter::Allocations);
+  }
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc{};
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+#endif
@@ -1,19 +1,46 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <system_error>
 #include <print>
+#include <ranges>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <anitomy.hpp>
 #include <anitomy/detail/cli.hpp>
+#include <anitomy/detail/cli/output.hpp>
 #include <anitomy/detail/cli/print.hpp>
+#include <anitomy/detail/cli/server.hpp>
+#include <anitomy/detail/cli/writer.hpp>
+#include <anitomy/detail/directory.hpp>
 #include <anitomy/detail/json.hpp>
+#include <anitomy/detail/mapped_file.hpp>
+#include <anitomy/detail/util.hpp>
+#include <anitomy/profile.hpp>
 #include <anitomy/version.hpp>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
 namespace {
 
 using namespace anitomy;
 using namespace anitomy::detail;  // don't try this at home
 
+// Inputs of the same shape (e.g. from the same release group) are parsed only once per engine
+constexpr EngineOptions engine_options{.shape_capacity = 4096};
+
 void print_usage() {
   std::println("anitomy {}", version());
   std::println("Usage: anitomy [options...] <input>");
@@ -26,8 +53,19 @@ void print_help() {
   std::println("Options:");
   std::println("  --help             You are here");
   std::println("  --stdin            Use standard input");
-  std::println("  --format=<format>  Set output format (`json` or `table`)");
+  std::println("  --format=<format>  Set output format (`json` or `table`, or in batch, scan and");
+  std::println("                     serve modes `json`, `csv`, `tsv` or `binary`)");
   std::println("  --pretty           Pretty print JSON");
+  std::println("  --batch            Parse each line of the input file (or standard input) and");
+  std::println("                     print a record for each");
+  std::println("  --scan             Parse the names of video files in the input directory tree");
+  std::println("                     and print a record for each");
+  std::println("  --serve            Parse requests of other processes on the Unix domain socket");
+  std::println("                     at the input path, until interrupted");
+  std::println("  --threads=<n>      Set number of threads in batch, scan and serve modes");
+  std::println("                     (0 uses all)");
+  std::println("  --profile          Print the time spent in each stage of the parser in batch,");
+  std::println("                     scan and serve modes (requires `ANITOMY_PROFILE`)");
 }
 
 void print_error(std::string_view message) {
@@ -46,13 +84,16 @@ void print_elements_table(const std::vector<Element>& elements) {
   print_table({"Element", "Value"}, rows);
 }
 
-void print_elements_json(const std::vector<Element>& elements, bool pretty) {
+json::Value elements_to_json(const std::vector<Element>& elements) {
   json::Value items{json::Value::object_t{}};
   for (const auto& element : elements) {
     items.as_object().emplace(to_string(element.kind), element.value);
   }
+  return items;
+}
 
-  std::print("{}", json::serialize(items, pretty));
+void print_elements_json(const std::vector<Element>& elements, bool pretty) {
+  std::print("{}", json::serialize(elements_to_json(elements), pretty));
 }
 
 bool is_trivial_token(const Token& token) noexcept {
@@ -77,7 +118,7 @@ void print_tokens_table(const std::vector<Token>& tokens, bool verbose) {
         std::string{to_string(token.kind)},
         std::string{token.keyword ? to_string(token.keyword->kind) : ""},
         std::string{token.element_kind ? to_string(*token.element_kind) : ""},
-        token.value,
+        std::string{token.value},
     });
   }
 
@@ -88,12 +129,217 @@ void print_tokens_json(const std::vector<Token>& tokens, bool pretty, bool verbo
   json::Value items{json::Value::array_t{}};
   for (const auto& token : tokens) {
     if (!verbose && is_trivial_token(token)) continue;
-    items.as_array().emplace_back(token.value);
+    items.as_array().emplace_back(std::string{token.value});
   }
 
   std::print("{}", json::serialize(items, pretty));
 }
 
+// Prints to standard error, so that it does not mix with the records
+void print_profile(Profile profile) {
+  const uint64_t input_count = profile[ProfileStage::Tokenize].calls;
+  const double total_ns = std::ranges::fold_left(
+      profile.stages | std::views::transform(&Profile::Stage::nanoseconds), 0.0, std::plus<>{});
+
+  std::println(std::cerr, "{:<18}{:>12}{:>12}{:>12}{:>8}", "stage", "calls", "total ms", "ns/call",
+               "share");
+  for (size_t i = 0; i < Profile::stage_count; ++i) {
+    const auto stage = static_cast<ProfileStage>(i);
+    const auto [calls, nanoseconds] = profile[stage];
+    std::println(std::cerr, "{:<18}{:>12}{:>12.3f}{:>12.1f}{:>7.1f}%", to_string(stage), calls,
+                 nanoseconds / 1e6, calls ? static_cast<double>(nanoseconds) / calls : 0.0,
+                 total_ns ? nanoseconds / total_ns * 100 : 0.0);
+  }
+  std::println(std::cerr, "{:<18}{:>12}{:>12.3f}", "total", input_count, total_ns / 1e6);
+
+  std::println(std::cerr, "\n{:<18}{:>12}{:>12}", "counter", "count", "per input");
+  for (size_t i = 0; i < Profile::counter_count; ++i) {
+    const auto counter = static_cast<ProfileCounter>(i);
+    const uint64_t count = profile[counter];
+    std::println(std::cerr, "{:<18}{:>12}{:>12.1f}", to_string(counter), count,
+                 input_count ? static_cast<double>(count) / input_count : 0.0);
+  }
+}
+
+size_t get_thread_count(const CommandLine& cli) {
+  if (!cli.contains("threads")) return 1;
+  return static_cast<size_t>(std::max(to_int(cli.get("threads")), 0));
+}
+
+// Parses blocks of lines in parallel, and writes the results in input order. Every line results in
+// exactly one line of output, so that results can be matched with their inputs.
+class Batch final {
+public:
+  Batch(const Options& options, OutputFormat format, size_t thread_count)
+      : options_{options}, format_{format}, thread_count_{thread_count} {
+    std::string header;
+    write_header(format_, false, header);
+    writer_.write(header);
+  }
+
+  // Blocks are cut into chunks of whole lines, which the threads process independently
+  void process(std::string_view block) {
+    chunks_.clear();
+    while (!block.empty()) {
+      chunks_.push_back(take_lines(block, chunk_size));
+      block.remove_prefix(chunks_.back().size());
+    }
+    if (results_.size() < chunks_.size()) results_.resize(chunks_.size());
+
+    parallel_for(chunks_.size(), thread_count_, 1, {}, [this](size_t first, size_t last) {
+      Engine engine{engine_options};
+      for (size_t i = first; i < last; ++i) {
+        results_[i].clear();
+        for_each_line(chunks_[i], [&](std::string_view line) {
+          write_record(format_, engine.parse(line, options_), results_[i]);
+        });
+      }
+    });
+
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      writer_.write(results_[i]);
+    }
+    writer_.flush();  // so that a producer that waits for the results gets them
+  }
+
+private:
+  static constexpr size_t chunk_size = 1 << 16;
+
+  const Options options_;
+  const OutputFormat format_;
+  const size_t thread_count_ = 1;
+  std::vector<std::string_view> chunks_;
+  std::vector<std::string> results_;
+  Writer writer_{stdout};
+};
+
+// Reads whatever is available on standard input, up to the size, without waiting for more. Returns
+// 0 at the end of the input.
+size_t read_stdin(char* data, const size_t size) {
+#ifdef _WIN32
+  constexpr size_t max_size = std::numeric_limits<int>::max();
+  const auto count = _read(_fileno(stdin), data, static_cast<unsigned>(std::min(size, max_size)));
+  return count > 0 ? static_cast<size_t>(count) : 0;
+#else
+  ssize_t count = 0;
+  do {
+    count = ::read(STDIN_FILENO, data, size);
+  } while (count < 0 && errno == EINTR);
+  return count > 0 ? static_cast<size_t>(count) : 0;
+#endif
+}
+
+// Input files are memory-mapped and parsed in place. Standard input is processed as it arrives,
+// and the partial line at the end of each read is carried over to the next block.
+int run_batch(const CommandLine& cli, const Options& options, const OutputFormat format) {
+  // Bounds the amount of output that is held in memory at once
+  constexpr size_t block_size = 1 << 24;
+
+  Batch batch{options, format, get_thread_count(cli)};
+
+  if (!cli.input().empty()) {
+    const MappedFile file{std::string{cli.input()}};
+    if (!file.is_open()) {
+      print_error("Cannot open input file");
+      return 1;
+    }
+    for (auto text = file.view(); !text.empty();) {
+      const auto block = take_lines(text, block_size);
+      batch.process(block);
+      text.remove_prefix(block.size());
+    }
+    return 0;
+  }
+
+  std::string buffer(block_size, '\0');
+  size_t size = 0;
+  while (const size_t count = read_stdin(buffer.data() + size, buffer.size() - size)) {
+    size += count;
+    const size_t end = std::string_view{buffer.data(), size}.rfind('\n');
+    if (end == std::string_view::npos) {
+      // A single line can be longer than the buffer
+      if (size == buffer.size()) buffer.resize(buffer.size() * 2);
+      continue;
+    }
+    batch.process({buffer.data(), end + 1});
+    size -= end + 1;
+    std::memmove(buffer.data(), buffer.data() + end + 1, size);
+  }
+  if (size) batch.process({buffer.data(), size});
+
+  return 0;
+}
+
+// Files are found first, and then parsed in blocks, which are written in the order of their paths.
+int run_scan(const CommandLine& cli, const Options& options, const OutputFormat format) {
+  constexpr size_t block_size = 16384;
+
+  const std::string root{cli.input()};
+  std::error_code error;
+  if (!std::filesystem::is_directory(root, error)) {
+    print_error("Cannot read directory");
+    return 1;
+  }
+
+  const size_t thread_count = get_thread_count(cli);
+  const auto paths = find_files(root, thread_count, {}, has_video_extension);
+
+  std::vector<std::string> results(std::min(block_size, paths.size()));
+  Writer writer{stdout};
+
+  std::string header;
+  write_header(format, true, header);
+  writer.write(header);
+
+  for (size_t offset = 0; offset < paths.size(); offset += block_size) {
+    const size_t count = std::min(block_size, paths.size() - offset);
+    const auto parse_paths = [&](const size_t first, const size_t last) {
+      Engine engine{engine_options};
+      for (size_t i = first; i < last; ++i) {
+        const auto& path = paths[offset + i];
+        results[i].clear();
+        write_record(format, path, engine.parse(file_name(path), options), results[i]);
+      }
+    };
+    parallel_for(count, thread_count, BatchOptions{}.chunk_size, {}, parse_paths);
+    for (size_t i = 0; i < count; ++i) {
+      writer.write(results[i]);
+    }
+  }
+
+  return 0;
+}
+
+#ifndef _WIN32
+// Signals are blocked on all threads, and this thread waits for them, so that the server can be
+// stopped cleanly (e.g. to remove the socket file).
+int run_serve(const CommandLine& cli, const Options& options, const OutputFormat format) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  Server server{options, format, get_thread_count(cli), engine_options};
+  if (!server.listen(std::string{cli.input()})) {
+    print_error("Cannot listen on socket");
+    return 1;
+  }
+
+  std::jthread thread{[&server](const std::stop_token& stop_token) { server.run(stop_token); }};
+  int received = 0;
+  sigwait(&signals, &received);
+
+  return 0;
+}
+#else
+int run_serve(const CommandLine&, const Options&, const OutputFormat) {
+  print_error("Serve mode is not supported on this platform");
+  return 1;
+}
+#endif
+
 }  // namespace
 
 int main(int argc, char* argv[]) {
@@ -103,6 +349,34 @@ int main(int argc, char* argv[]) {
     print_help();
     return 0;
   }
+  if (cli.contains("batch") || cli.contains("scan") || cli.contains("serve")) {
+    const auto format = to_output_format(cli.get("format", "json"));
+    if (!format) {
+      print_error("Invalid format value");
+      return 1;
+    }
+#ifdef _WIN32
+    if (*format == OutputFormat::Binary) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    const bool profile = cli.contains("profile");
+    if (profile && !profile_enabled) {
+      print_error("Profiling is not enabled in this build");
+      return 1;
+    }
+    int result = 0;
+    if (cli.contains("batch")) {
+      result = run_batch(cli, {}, *format);
+    } else if (cli.input().empty()) {
+      print_usage();
+      return 1;
+    } else if (cli.contains("serve")) {
+      result = run_serve(cli, {}, *format);
+    } else {
+      result = run_scan(cli, {}, *format);
+    }
+    if (profile && !result) print_profile(anitomy::profile());
+    return result;
+  }
   if (cli.input().empty()) {
     print_usage();
     return 1;
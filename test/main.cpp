@@ -1,19 +1,182 @@
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <limits>
 #include <map>
+#include <memory_resource>
 #include <print>
+#include <ranges>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 #include <anitomy.hpp>
+#include <anitomy/batch_file.hpp>
+#include <anitomy/cache.hpp>
+#include <anitomy/columnar.hpp>
+#include <anitomy/disk_cache.hpp>
+#include <anitomy/keyword.hpp>
+#include <anitomy/number.hpp>
+#include <anitomy/profile.hpp>
+#include <anitomy/result.hpp>
+#include <anitomy/scan.hpp>
 #include <anitomy/detail/cli.hpp>
+#include <anitomy/detail/cli/output.hpp>
+#include <anitomy/detail/cli/server.hpp>
+#include <anitomy/detail/cli/writer.hpp>
 #include <anitomy/detail/json.hpp>
+#include <anitomy/detail/mapped_file.hpp>
+#include <anitomy/detail/token_index.hpp>
 #include <anitomy/detail/unicode.hpp>
 
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
 namespace {
 
+void test_batch() {
+  const std::array<std::string_view, 5> inputs{
+      "[Ouroboros] Fullmetal Alchemist Brotherhood - 01",
+      "",
+      "Toradora! (2008) - 02v2 [720p]",
+      "[TaigaSubs]_Toradora!_(2008)_-_03v2_-_Christmas_Party_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "Detective Conan - 316-317 [DCTP][2411959B].mkv",
+  };
+
+  for (const size_t thread_count : {1, 2, 8}) {
+    // The largest chunk size means a single chunk
+    for (const size_t chunk_size : {size_t{0}, size_t{1}, size_t{2}, size_t{256},
+                                    std::numeric_limits<size_t>::max()}) {
+      const anitomy::BatchOptions batch_options{
+          .thread_count = thread_count,
+          .chunk_size = chunk_size,
+      };
+      const auto results = anitomy::parse_batch(inputs, {}, batch_options);
+      assert(results.size() == inputs.size());
+      for (size_t i = 0; i < inputs.size(); ++i) {
+        assert(results[i] == anitomy::parse(inputs[i]));
+      }
+    }
+  }
+
+  {
+    std::stop_source stop_source;
+    stop_source.request_stop();
+    const auto results = anitomy::parse_batch(inputs, {}, {.stop_token = stop_source.get_token()});
+    assert(results.size() == inputs.size());
+    assert(std::ranges::all_of(results, [](const auto& elements) { return elements.empty(); }));
+  }
+
+  assert(anitomy::parse_batch({}).empty());
+}
+
+void test_batch_file() {
+  namespace fs = std::filesystem;
+  const auto path = (fs::temp_directory_path() / "anitomy-test-batch.txt").string();
+
+  const std::array<std::string_view, 4> inputs{
+      "[Ouroboros] Fullmetal Alchemist Brotherhood - 01",
+      "",
+      "Toradora! (2008) - 02v2 [720p]",
+      "Detective Conan - 316-317 [DCTP][2411959B].mkv",
+  };
+  {
+    std::ofstream file{path, std::ios::binary};
+    file << inputs[0] << "\n" << inputs[1] << "\r\n" << inputs[2] << "\n" << inputs[3];
+  }
+
+  for (const size_t thread_count : {1, 4}) {
+    const auto results = anitomy::parse_file_lines(path, {}, {.thread_count = thread_count});
+    assert(results && results->size() == inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      assert((*results)[i] == anitomy::parse(inputs[i]));
+    }
+  }
+
+  std::vector<std::string> lines(inputs.size());
+  const bool success = anitomy::parse_file_lines(
+      path, {}, {}, [&](size_t line_number, std::string_view line, const auto& elements) {
+        assert(elements == anitomy::parse(line));
+        lines[line_number] = line;
+      });
+  assert(success);
+  assert(std::ranges::equal(lines, inputs));
+
+  fs::remove(path);
+  assert(!anitomy::parse_file_lines(path));
+}
+
+void test_cache() {
+  const std::array<std::string_view, 3> inputs{
+      "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "Toradora! (2008) - 02v2 [720p]",
+      "",
+  };
+
+  {
+    anitomy::CachedParser parser;
+    for (size_t i = 0; i < 3; ++i) {
+      for (const auto input : inputs) {
+        assert(*parser.parse(input) == anitomy::parse(input));
+      }
+    }
+    auto stats = parser.stats();
+    assert(stats.misses == 3);
+    assert(stats.hits == 6);
+    assert(stats.evictions == 0);
+    assert(stats.entries == 3);
+    assert(stats.memory > 0);
+
+    // Options are a part of the key
+    anitomy::Options options;
+    options.parse_episode = false;
+    assert(*parser.parse(inputs[0], options) == anitomy::parse(inputs[0], options));
+    assert(parser.stats().misses == 4);
+
+    parser.clear();
+    stats = parser.stats();
+    assert(stats.hits == 0 && stats.entries == 0 && stats.memory == 0);
+  }
+
+  {
+    // Least recently used entries are evicted, but results stay valid
+    anitomy::CachedParser parser{{.capacity = 2048, .shard_count = 1}};
+    const auto first = parser.parse(inputs[0]);
+    for (size_t i = 0; i < 100; ++i) {
+      std::ignore = parser.parse(std::format("Title - {:02}", i));
+    }
+    const auto stats = parser.stats();
+    assert(stats.evictions > 0);
+    assert(stats.memory <= 2048);
+    assert(*first == anitomy::parse(inputs[0]));
+    std::ignore = parser.parse(inputs[0]);
+    assert(parser.stats().misses == 102);
+  }
+
+  {
+    anitomy::CachedParser parser{{.capacity = 4096, .shard_count = 4}};
+    std::vector<std::jthread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+      threads.emplace_back([&parser, &inputs] {
+        for (size_t j = 0; j < 200; ++j) {
+          const auto input = inputs[j % inputs.size()];
+          assert(*parser.parse(input) == anitomy::parse(input));
+          std::ignore = parser.parse(std::format("Title - {:02}", j));
+        }
+      });
+    }
+  }
+}
+
 void test_cli() {
   using namespace anitomy::detail;
 
@@ -39,6 +202,256 @@ void test_cli() {
     assert(cl.get("format") == "json");
     assert(cl.input() == "test");
   }
+  {
+    const std::vector<anitomy::Element> elements{
+        {anitomy::ElementKind::Title, "Title, \"The\"", 0},
+        {anitomy::ElementKind::Episode, "01", 16},
+        {anitomy::ElementKind::Episode, "02", 19},
+        {anitomy::ElementKind::EpisodeTitle, "A\tB", 22},
+    };
+    std::string output;
+    write_record(OutputFormat::Json, elements, output);
+    assert(output == R"({"episode":"01","episode_title":"A\tB","title":"Title, \"The\""})" "\n");
+    output.clear();
+    write_record(OutputFormat::Csv, "a,b", elements, output);
+    assert(output == R"("a,b",,,01,A	B,,,,,,,,,,,"Title, ""The""",,,,,)" "\n");
+    output.clear();
+    write_record(OutputFormat::Tsv, elements, output);
+    assert(output == "\t\t01\tA\\tB\t\t\t\t\t\t\t\t\t\t\tTitle, \"The\"\t\t\t\t\t\n");
+    output.clear();
+    write_record(OutputFormat::Binary, std::span{elements}.first(1), output);
+    assert(output == std::string_view("\x17\0\0\0\x01\0\x0e\0\0\0\0\x0c\0\0\0Title, \"The\"", 27));
+  }
+  {
+    std::FILE* file = std::tmpfile();
+    assert(file);
+    {
+      Writer writer{file, 8};
+      writer.write("abc");
+      writer.write('\n');
+      writer.write("longer than the buffer");
+      writer.write('\n');
+    }
+    std::rewind(file);
+    std::array<char, 64> buffer{};
+    const size_t size = std::fread(buffer.data(), 1, buffer.size(), file);
+    assert(std::string_view(buffer.data(), size) == "abc\nlonger than the buffer\n");
+    std::fclose(file);
+  }
+}
+
+void test_columnar() {
+  const std::array<std::string_view, 5> inputs{
+      "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "",
+      "[TaigaSubs]_Toradora!_(2008)_-_02_-_Pool_[1280x720_H.264_FLAC][5678ABCD].mkv",
+      "Toradora! (2008) - 03 [720p]",
+      "Detective Conan - 316-317 [DCTP][2411959B].mkv",
+  };
+
+  const auto expected = anitomy::parse_batch(inputs);
+
+  for (const size_t thread_count : {1, 2, 8}) {
+    for (const size_t chunk_size : {1, 2, 256}) {
+      const anitomy::BatchOptions batch_options{
+          .thread_count = thread_count,
+          .chunk_size = chunk_size,
+      };
+      const auto result = anitomy::parse_batch_columnar(inputs, {}, batch_options);
+      assert(result.input_count() == inputs.size());
+      for (size_t i = 0; i < inputs.size(); ++i) {
+        assert(result.to_elements(i) == expected[i]);
+      }
+    }
+  }
+
+  const auto result = anitomy::parse_batch_columnar(inputs);
+
+  // Iterating over all elements keeps track of their inputs
+  {
+    auto it = result.begin();
+    for (size_t i = 0; i < expected.size(); ++i) {
+      for (const auto& element : expected[i]) {
+        assert(it != result.end());
+        assert(*it == (anitomy::ElementView{element.kind, element.value, element.position, i}));
+        ++it;
+      }
+    }
+    assert(it == result.end());
+    assert(static_cast<size_t>(std::ranges::distance(result)) == result.size());
+  }
+
+  // Values of dictionary kinds are stored once
+  {
+    const auto find = [&](size_t input, anitomy::ElementKind kind) {
+      const auto [first, last] = result.element_range(input);
+      for (size_t i = first; i < last; ++i) {
+        if (result.kind(i) == kind) return result.value_id(i);
+      }
+      assert(false);
+      return uint32_t{0};
+    };
+    using enum anitomy::ElementKind;
+    assert(find(0, ReleaseGroup) == find(2, ReleaseGroup));
+    assert(find(0, VideoTerm) == find(2, VideoTerm));
+    assert(find(0, FileExtension) == find(4, FileExtension));
+    assert(find(0, Title) == find(2, Title));
+    assert(find(0, EpisodeTitle) != find(2, EpisodeTitle));
+    assert(result.string(find(0, ReleaseGroup)) == "TaigaSubs");
+
+    // Values that are spelled as keywords are not stored
+    assert(find(0, AudioTerm) == anitomy::find_keyword("FLAC"));
+    assert(result.string(find(0, AudioTerm)) == "FLAC");
+  }
+
+  {
+    std::stop_source stop_source;
+    stop_source.request_stop();
+    const auto stopped =
+        anitomy::parse_batch_columnar(inputs, {}, {.stop_token = stop_source.get_token()});
+    assert(stopped.input_count() == inputs.size());
+    assert(stopped.size() == 0);
+    assert(stopped.begin() == stopped.end());
+  }
+
+  // Strings are stored in blocks, whose offsets are kept separately
+  {
+    std::vector<std::string> titles;
+    std::vector<std::string_view> names;
+    for (size_t i = 0; i < 3000; ++i) titles.push_back(std::format("Title {} - Episode Title", i));
+    for (const auto& title : titles) names.push_back(title);
+    auto many = anitomy::parse_batch_columnar(names, {}, {.thread_count = 2, .chunk_size = 7});
+    assert(many.input_count() == names.size());
+    for (size_t i = 0; i < names.size(); i += 499) {
+      assert(many.to_elements(i) == anitomy::parse(names[i]));
+    }
+    many.clear();
+    assert(many.input_count() == 0 && many.size() == 0 && many.string_count() == 0);
+    many.append(expected[0]);
+    assert(many.to_elements(0) == expected[0]);
+  }
+}
+
+void test_disk_cache() {
+  namespace fs = std::filesystem;
+  const auto path = (fs::temp_directory_path() / "anitomy-test-cache.bin").string();
+  fs::remove(path);
+
+  const std::array<std::string_view, 3> inputs{
+      "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "Toradora! (2008) - 02v2 [720p]",
+      "",
+  };
+  anitomy::Options options;
+  options.parse_episode = false;
+
+  {
+    anitomy::DiskCache cache{path};
+    assert(cache.is_open());
+    for (const auto input : inputs) {
+      assert(!cache.find(input));
+      assert(cache.parse(input) == anitomy::parse(input));
+      assert(cache.find(input) == anitomy::parse(input));  // before it is written
+    }
+    assert(!cache.find(inputs[0], options));
+    assert(cache.parse(inputs[0], options) == anitomy::parse(inputs[0], options));
+    assert(cache.size() == 4);
+  }
+
+  {
+    anitomy::DiskCache cache{path};
+    assert(cache.size() == 4);
+    for (const auto input : inputs) {
+      assert(cache.find(input) == anitomy::parse(input));
+    }
+    assert(cache.find(inputs[0], options) == anitomy::parse(inputs[0], options));
+  }
+
+  // A partially written record is dropped
+  fs::resize_file(path, fs::file_size(path) - 1);
+  {
+    anitomy::DiskCache cache{path};
+    assert(cache.size() == 3);
+    assert(!cache.find(inputs[0], options));
+    assert(cache.parse(inputs[0], options) == anitomy::parse(inputs[0], options));
+  }
+  assert(anitomy::DiskCache{path}.size() == 4);
+
+  // Results of another version are discarded
+  {
+    std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(12);
+    file.put('\xff');
+  }
+  assert(anitomy::DiskCache{path}.size() == 0);
+
+  // Other files are not touched
+  {
+    std::ofstream file{path, std::ios::binary};
+    file << "not a cache";
+  }
+  assert(!anitomy::DiskCache{path}.is_open());
+  assert(fs::file_size(path) == 11);
+
+  // Files that cannot be read are not taken for missing ones
+  fs::permissions(path, fs::perms::owner_write);
+  assert(!anitomy::DiskCache{path}.is_open());
+  fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write);
+  assert(fs::file_size(path) == 11);
+  fs::remove(path);
+#ifndef _WIN32
+  assert(::mkfifo(path.c_str(), 0600) == 0);
+  assert(!anitomy::DiskCache{path}.is_open());
+  assert(fs::is_fifo(path));
+#endif
+
+  fs::remove(path);
+}
+
+void test_engine() {
+  const std::array<std::string_view, 4> inputs{
+      "[Ouroboros] Fullmetal Alchemist Brotherhood - 01",
+      "",
+      "[TaigaSubs]_Toradora!_(2008)_-_03v2_-_Christmas_Party_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "Toradora! (2008) - 02v2 [720p]",
+  };
+
+  anitomy::Engine engine;
+
+  // Results must not depend on what was parsed before
+  for (size_t n = 0; n < 2; ++n) {
+    for (const auto input : inputs) {
+      assert(engine.parse(input) == anitomy::parse(input));
+    }
+  }
+
+  anitomy::Options options;
+  options.parse_episode = false;
+  assert(engine.parse(inputs[0], options) == anitomy::parse(inputs[0], options));
+
+  // Inputs of the same shape are derived from the first one, and words that the rules look at
+  // (e.g. `Second`, `of`, `DEADBEEF`) are a part of the shape
+  const std::array<std::string_view, 10> shaped_inputs{
+      "[TaigaSubs]_Toradora!_(2008)_-_03v2_-_Christmas_Party_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "[Group]_Kanokon!_(2008)_-_03v2_-_Summer_Vacation_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "[Group]_Kanokon!_(2011)_-_12v3_-_Summer_Vacation_[1280x720_H.264_FLAC][ABCD1234].mkv",
+      "Title Second Season - 01",
+      "Title Final Season - 01",
+      "Title II - 01",
+      "Title of Heroes - 01",
+      "Title and Heroes - 01",
+      "[Group] Title - DEADBEEF",
+      "[Group] Title - DEADBEAT",
+  };
+  for (const size_t capacity : {1, 16}) {
+    anitomy::Engine shape_engine{{.shape_capacity = capacity}};
+    for (size_t n = 0; n < 2; ++n) {
+      for (const auto input : shaped_inputs) {
+        assert(shape_engine.parse(input) == anitomy::parse(input));
+        assert(shape_engine.parse(input, options) == anitomy::parse(input, options));
+      }
+    }
+  }
 }
 
 void test_json() {
@@ -92,6 +505,10 @@ void test_json() {
     assert(value.as_string() == R"(test\test)");
     assert(json::serialize(value) == str);
   }
+  {
+    const json::Value value{std::string{"\ttab\nline\x01"}};
+    assert(json::serialize(value) == R"("\ttab\nline\u0001")");
+  }
   {
     auto value = json::parse("123");
     assert(value.is_integer());
@@ -168,6 +585,157 @@ void test_json() {
   }
 }
 
+void test_keyword() {
+  using namespace anitomy::detail;
+
+  assert(keyword_trie.find("") == nullptr);
+  assert(keyword_trie.find("AA") == nullptr);
+  assert(keyword_trie.find("AAC")->kind == KeywordKind::AudioCodec);
+  assert(keyword_trie.find("aac")->kind == KeywordKind::AudioCodec);
+  assert(keyword_trie.find("AACX2")->kind == KeywordKind::AudioCodec);
+  assert(keyword_trie.find("AACX") == nullptr);
+  assert(keyword_trie.find("Episódio")->kind == KeywordKind::Episode);
+  assert(keyword_trie.find("DivX")->kind == KeywordKind::FileExtension);  // first one wins
+  assert(keyword_trie.find("1080p")->is_bounded() == false);
+  assert(keyword_trie.find("Opus")->is_ambiguous());
+
+  for (const auto& [key, keyword] : keywords) {
+    assert(keyword_trie.find(key) != nullptr);
+  }
+
+  for (size_t i = 0; i < keywords.size(); ++i) {
+    assert(keywords[i].second.id == i);
+  }
+  assert(keyword_value(*keyword_trie.find("flac")) == "FLAC");
+
+  static_assert(anitomy::keyword_value(*anitomy::find_keyword("FLAC")) == "FLAC");
+  static_assert(!anitomy::find_keyword("flac"));
+  static_assert(!anitomy::find_keyword("FLACX"));
+  static_assert(anitomy::find_keyword("BD") != anitomy::find_keyword("BDRip"));
+}
+
+void test_mapped_file() {
+  using anitomy::detail::MappedFile;
+  namespace fs = std::filesystem;
+  const auto path = (fs::temp_directory_path() / "anitomy-test-mapped.txt").string();
+
+  fs::remove(path);
+  assert(!MappedFile{path}.is_open());
+
+  std::ofstream{path};
+  {
+    const MappedFile file{path};
+    assert(file.is_open());
+    assert(file.view().empty());
+  }
+
+  {
+    std::ofstream file{path, std::ios::binary};
+    file << "[Group] Title - 01.mkv\r\nTitle - 02.mkv\n";
+  }
+  std::string contents;
+  assert(anitomy::detail::read_file(path, contents));
+  {
+    MappedFile file{path};
+    assert(file.is_open());
+    assert(file.view() == contents);
+
+    MappedFile moved{std::move(file)};
+    assert(!file.is_open() && file.view().empty());
+    assert(moved.is_open() && moved.view() == contents);
+
+    file = std::move(moved);
+    assert(file.view() == contents);
+    assert(!moved.is_open());
+
+    file.close();
+    assert(!file.is_open() && file.view().empty());
+    assert(file.open(path) && file.view() == contents);
+  }
+
+  fs::remove(path);
+}
+
+void test_matcher() {
+  using namespace anitomy::detail;
+
+  const auto groups = [](auto match) {
+    std::vector<std::string_view> groups;
+    if (match) groups.assign(match->begin(), match->end());
+    return groups;
+  };
+
+  using groups_t = std::vector<std::string_view>;
+
+  assert(groups(match_episode_prefix("E1")) == groups_t({"1", ""}));
+  assert(groups(match_episode_prefix("EP01v2")) == groups_t({"01", "2"}));
+  assert(groups(match_episode_prefix("Eps001")) == groups_t({"001", ""}));
+  assert(groups(match_episode_prefix("EPs01")).empty());
+  assert(groups(match_episode_prefix("E12345")).empty());
+  assert(groups(match_episode_prefix("E01v")).empty());
+
+  assert(groups(match_single_episode("01v2")) == groups_t({"01", "2"}));
+  assert(groups(match_single_episode("01")).empty());
+
+  assert(groups(match_multi_episode("01~02")) == groups_t({"01", "", "02", ""}));
+  assert(groups(match_multi_episode("03v2~05v3")) == groups_t({"03", "2", "05", "3"}));
+  assert(groups(match_multi_episode("01~")).empty());
+
+  assert(groups(match_season_and_episode("2x01")) == groups_t({"2", "", "01", "", ""}));
+  assert(groups(match_season_and_episode("S01E03")) == groups_t({"01", "", "03", "", ""}));
+  assert(groups(match_season_and_episode("S01.E03v2")) == groups_t({"01", "", "03", "", "2"}));
+  assert(groups(match_season_and_episode("S01-02xE001-150")) ==
+         groups_t({"01", "02", "001", "150", ""}));
+  assert(groups(match_season_and_episode("S01-E03")).empty());
+  assert(groups(match_season_and_episode("S123E03")).empty());
+
+  assert(groups(match_number_sign("#01")) == groups_t({"01", "", ""}));
+  assert(groups(match_number_sign("#02~03v2")) == groups_t({"02", "03", "2"}));
+  assert(groups(match_number_sign("01")).empty());
+
+  assert(groups(match_japanese_episode("第01話")) == groups_t({"01"}));
+  assert(groups(match_japanese_episode("01話")) == groups_t({"01"}));
+  assert(groups(match_japanese_episode("第01")).empty());
+
+  assert(groups(match_season("S2")) == groups_t({"2"}));
+  assert(groups(match_season("S123")).empty());
+  assert(groups(match_japanese_season("第2期")) == groups_t({"2"}));
+
+  assert(is_partial_episode("4a"));
+  assert(is_partial_episode("111C"));
+  assert(!is_partial_episode("4d"));
+
+  assert(is_video_resolution("1080p"));
+  assert(is_video_resolution("1920x1080"));
+  assert(is_video_resolution("1280×720"));
+  assert(is_video_resolution("720X480i"));
+  assert(!is_video_resolution("10800p"));
+  assert(!is_video_resolution("1080px"));
+}
+
+void test_number() {
+  using anitomy::Number;
+  using anitomy::VideoResolution;
+
+  assert(anitomy::to_number("01") == Number{.value = 1});
+  assert((anitomy::to_number("07.5") == Number{.value = 7, .is_half = true}));
+  assert((anitomy::to_number("4a") == Number{.value = 4, .suffix = 'a'}));
+  assert(!anitomy::to_number(""));
+  assert(!anitomy::to_number("a"));
+  assert(!anitomy::to_number("1.11"));
+  assert(!anitomy::to_number("12ab"));
+
+  assert((anitomy::to_video_resolution("1080p") == VideoResolution{.height = 1080, .scan = 'p'}));
+  assert((anitomy::to_video_resolution("1080") == VideoResolution{.height = 1080}));
+  assert((anitomy::to_video_resolution("1920x1080") ==
+          VideoResolution{.width = 1920, .height = 1080}));
+  assert((anitomy::to_video_resolution("1920×1080i") ==
+          VideoResolution{.width = 1920, .height = 1080, .scan = 'i'}));
+  assert((anitomy::to_video_resolution("4K") == VideoResolution{.width = 3840, .height = 2160}));
+  assert(!anitomy::to_video_resolution("1920x"));
+  assert(!anitomy::to_video_resolution("HD"));
+}
+
 void test_parser() {
   using namespace anitomy::detail;
 
@@ -181,6 +749,329 @@ void test_parser() {
     assert(p.tokens().empty());
     assert(p.elements().empty());
   }
+  {
+    // Stray close bracket after the title
+    Tokenizer t{"[Group] Title]"};
+    t.tokenize(options);
+    Parser p{t.tokens()};
+    p.parse(options);
+    assert(p.elements().size() == 2);
+    assert(p.elements()[0].kind == anitomy::ElementKind::ReleaseGroup);
+    assert(p.elements()[1].kind == anitomy::ElementKind::Title);
+    assert(p.elements()[1].value == "Title");
+  }
+  {
+    // Keywords are spelled as in the keyword table
+    const std::string_view input = "Title - 01 [flac][bdrip][V2].MKV";
+    anitomy::Options canonical;
+    canonical.canonical_keywords = true;
+    Tokenizer t{input};
+    t.tokenize(canonical);
+    Parser p{t.tokens()};
+    p.parse(canonical);
+    const auto value = [&](anitomy::ElementKind kind) {
+      return std::ranges::find(p.elements(), kind, &anitomy::Element::kind)->value;
+    };
+    assert(value(anitomy::ElementKind::AudioTerm) == "FLAC");
+    assert(value(anitomy::ElementKind::Source) == "BDRip");
+    assert(value(anitomy::ElementKind::ReleaseVersion) == "2");
+    assert(value(anitomy::ElementKind::FileExtension) == "mkv");
+    // The input is recovered by position
+    const auto& extension = p.elements().back();
+    assert(input.substr(extension.position, extension.value.size()) == "MKV");
+    assert(anitomy::parse(input).back().value == "MKV");
+  }
+  {
+    // Only the requested kinds are returned, with the same values as in a full parse
+    using enum anitomy::ElementKind;
+    const std::array<std::string_view, 4> inputs{
+        "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[720p_H.264_FLAC][1234ABCD].mkv",
+        "[Group] Title S2 - 03 - Episode Title [1080p].mkv",
+        "Title.Ep01.720p.x264-Group.mkv",
+        "[ReinForce] Title Vol.2 [BDRip 1920x1080 x264 FLAC]",
+    };
+    const std::array<anitomy::ElementSet, 6> sets{{
+        {},
+        {Title, Episode},
+        {FileExtension},
+        {VideoTerm, AudioTerm},
+        {ReleaseGroup},
+        {EpisodeTitle, Volume},
+    }};
+    for (const auto input : inputs) {
+      const auto all = anitomy::parse(input);
+      for (const auto kinds : sets) {
+        anitomy::Options some;
+        some.kinds = kinds;
+        auto expected = all;
+        std::erase_if(expected, [&](const auto& element) { return !kinds.contains(element.kind); });
+        assert(anitomy::parse(input, some) == expected);
+      }
+    }
+    assert(last_stage({}) == std::nullopt);
+    assert(last_stage({FileExtension}) == ParserStage::FileExtension);
+    assert(last_stage({Title, Episode}) == ParserStage::Title);
+    assert(last_stage(anitomy::ElementSet::all()) == ParserStage::EpisodeTitle);
+  }
+  {
+    // Values of dropped elements are not built, so they cannot be allocated with a null resource
+    Tokenizer t{"[A Long Release Group Name] A Title That Does Not Fit In A Small String - 01"};
+    t.tokenize(options);
+    TokenIndex index;
+    index.build(t.tokens());
+    std::pmr::vector<anitomy::pmr::Element> values{std::pmr::null_memory_resource()};
+    ElementFilter elements{values, {anitomy::ElementKind::Episode}};
+    parse_title(t.tokens(), index, elements);
+    parse_release_group(t.tokens(), index, elements);
+    assert(elements.contains(anitomy::ElementKind::Title));
+    assert(elements.contains(anitomy::ElementKind::ReleaseGroup));
+    assert(elements.size() == 2);
+    assert(values.empty());
+  }
+  {
+    // Options that are fixed at compile time give the same result
+    using enum anitomy::ElementKind;
+    static constexpr anitomy::Options fixed{
+        .parse_episode_title = false,
+        .parse_release_group = false,
+        .canonical_keywords = true,
+        .kinds = {Title, Episode, VideoTerm, FileExtension},
+    };
+    const std::string_view input = "[Group] Title - 01 - Episode Title [1080p x264].MKV";
+    assert(anitomy::parse<anitomy::Options{}>(input) == anitomy::parse(input));
+    assert(anitomy::parse<fixed>(input) == anitomy::parse(input, fixed));
+    assert(anitomy::parse<fixed>(input).back().value == "mkv");
+    std::pmr::monotonic_buffer_resource resource;
+    const auto elements =
+        anitomy::parse<fixed>(input, std::pmr::polymorphic_allocator<char>{&resource});
+    assert(elements.size() == anitomy::parse(input, fixed).size());
+  }
+}
+
+void test_pmr() {
+  const std::string_view input =
+      "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[1280x720_H.264_FLAC][1234ABCD].mkv";
+
+  std::vector<std::byte> buffer(64 * 1024);
+  std::pmr::monotonic_buffer_resource resource{buffer.data(), buffer.size(),
+                                               std::pmr::null_memory_resource()};
+
+  const auto elements = anitomy::pmr::parse(input, {}, &resource);
+  const auto expected = anitomy::parse(input);
+
+  assert(elements.size() == expected.size());
+  for (size_t i = 0; i < elements.size(); ++i) {
+    assert(elements[i].kind == expected[i].kind);
+    assert(std::string_view{elements[i].value} == expected[i].value);
+    assert(elements[i].position == expected[i].position);
+    assert(elements[i].value.get_allocator().resource() == &resource);
+  }
+}
+
+void test_profile() {
+  using anitomy::ProfileCounter;
+  using anitomy::ProfileStage;
+
+  anitomy::reset_profile();
+  std::ignore = anitomy::parse("[Group] Title - 01 [1080p].mkv");
+  std::ignore = anitomy::parse("Title - 02.mkv");
+
+  auto profile = anitomy::profile();
+  if constexpr (anitomy::profile_enabled) {
+    assert(profile[ProfileStage::Tokenize].calls == 2);
+    assert(profile[ProfileStage::Index].calls == 2);
+    assert(profile[ProfileStage::Title].calls == 2);
+    assert(profile[ProfileStage::VideoResolution].calls == 2);
+    assert(profile[ProfileCounter::KeywordProbes] > 0);
+    assert(profile[ProfileCounter::MatcherCalls] > 0);
+    assert(profile[ProfileStage::Replay].calls == 0);
+  } else {
+    assert(profile[ProfileStage::Tokenize].calls == 0);
+    assert(profile[ProfileCounter::KeywordProbes] == 0);
+  }
+
+  anitomy::reset_profile();
+  profile = anitomy::profile();
+  assert(profile[ProfileStage::Tokenize].calls == 0);
+  assert(profile[ProfileStage::Tokenize].nanoseconds == 0);
+}
+
+void test_result() {
+  using enum anitomy::ElementKind;
+
+  const std::string_view input =
+      "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[1280x720_H.264_FLAC][1234ABCD].mkv";
+  const auto expected = anitomy::parse(input);
+
+  const auto result = anitomy::parse_result(input);
+  assert(result.size() == expected.size());
+  assert(std::ranges::equal(result, expected));
+  assert(result.to_vector() == expected);
+
+  assert(result.contains(Episode));
+  assert(!result.contains(Season));
+  assert(result.first(Season) == nullptr);
+  assert(result.first(Episode)->value == "01");
+  assert(result.value(Title) == "Toradora!");
+  assert(result.value(Season).empty());
+
+  const auto video_terms = result.all(VideoTerm);
+  assert(std::ranges::distance(video_terms) == 1);
+  assert(video_terms.front().value == "H.264");
+  assert(result.all(Season).empty());
+
+  // Numbers
+  assert(result.number(Episode) == anitomy::Number{.value = 1});
+  assert(result.year() == 2008);
+  assert(!result.number(Season));
+  assert((result.video_resolution() == anitomy::VideoResolution{.width = 1280, .height = 720}));
+  {
+    const auto range = anitomy::parse_result("[Group] Title - 316 & 317 [720p]").range(Episode);
+    assert((range == anitomy::NumberRange{{.value = 316}, {.value = 317}}));
+    const auto resolution = anitomy::parse_result("Title - 01 [720p]").video_resolution();
+    assert((resolution == anitomy::VideoResolution{.height = 720, .scan = 'p'}));
+    assert(anitomy::parse_result("Title - 07.5").number(Episode)->is_half);
+    assert(anitomy::parse_result("Title - 4a").number(Episode)->suffix == 'a');
+  }
+
+  // More elements than can be stored inline, and repeated kinds in position order
+  std::vector<anitomy::Element> elements;
+  for (size_t i = 0; i < 40; ++i) {
+    elements.emplace_back(i % 2 ? AudioTerm : Other, std::format("{}", i), i);
+  }
+  anitomy::Result large{elements};
+  assert(large.size() == 40);
+  assert(large.count(AudioTerm) == 20);
+  assert(large.first(AudioTerm)->value == "1");
+  size_t position = 0;
+  for (const auto& element : large.all(Other)) {
+    assert(element.position == position);
+    position += 2;
+  }
+  assert(position == 40);
+
+  // The storage is reused
+  large.assign(expected);
+  assert(large == result);
+  large.assign({});
+  assert(large.empty());
+  assert(!large.contains(Title));
+}
+
+void test_scan() {
+  namespace fs = std::filesystem;
+
+  const auto root = fs::temp_directory_path() / "anitomy-test-scan";
+  fs::remove_all(root);
+  fs::create_directories(root / "Toradora!" / "Extras");
+  fs::create_directories(root / "Empty");
+  for (const auto& path : {
+           root / "Toradora!" / "[TaigaSubs] Toradora! - 01 [720p].mkv",
+           root / "Toradora!" / "[TaigaSubs] Toradora! - 02 [720p].MP4",
+           root / "Toradora!" / "Extras" / "Toradora! - NCOP.avi",
+           root / "Toradora!" / "cover.jpg",
+           root / "notes.txt",
+       }) {
+    std::ofstream{path};
+  }
+
+  const auto results = anitomy::scan(root.string(), {}, {.thread_count = 2});
+  assert(results.size() == 3);
+  assert(results[0].path.ends_with("/Extras/Toradora! - NCOP.avi"));
+  assert(results[1].path.ends_with("/[TaigaSubs] Toradora! - 01 [720p].mkv"));
+  assert(results[2].path.ends_with("/[TaigaSubs] Toradora! - 02 [720p].MP4"));
+  assert(results[1].elements == anitomy::parse("[TaigaSubs] Toradora! - 01 [720p].mkv"));
+  assert(results[2].elements == anitomy::parse("[TaigaSubs] Toradora! - 02 [720p].MP4"));
+
+  assert(anitomy::scan((root / "missing").string()).empty());
+
+#ifndef _WIN32
+  // Links to files are followed, and links to directories are not
+  fs::create_symlink(root / "Toradora!" / "Extras" / "Toradora! - NCOP.avi", root / "link.avi");
+  fs::create_directory_symlink(root / "Toradora!", root / "Empty" / "link");
+  const auto linked = anitomy::scan(root.string());
+  assert(linked.size() == 4);
+  assert(linked[3].path.ends_with("/link.avi"));
+#endif
+
+  fs::remove_all(root);
+}
+
+void test_server() {
+#ifndef _WIN32
+  using namespace anitomy::detail;
+
+  const auto path =
+      (std::filesystem::temp_directory_path() / std::format("anitomy-test-{}.sock", ::getpid()))
+          .string();
+
+  const std::vector<std::string_view> names{
+      "[TaigaSubs]_Toradora!_(2008)_-_01v2_-_Tiger_and_Dragon_[1280x720_H.264_FLAC][1234ABCD].mkv",
+      "Title - 02.mkv",
+      "",
+  };
+  std::string expected;
+  for (const auto name : names) {
+    write_record(OutputFormat::Json, anitomy::parse(name), expected);
+  }
+
+  {
+    Server server{{}, OutputFormat::Json, 2};
+    assert(server.listen(path));
+    assert(std::filesystem::exists(path));
+    {
+      Server other{{}, OutputFormat::Json, 1};
+      assert(!other.listen(path));  // already in use
+    }
+
+    std::jthread thread{[&server](const std::stop_token& stop_token) { server.run(stop_token); }};
+
+    // Concurrent clients, each with a series of requests on a single connection
+    {
+      std::vector<std::jthread> clients;
+      for (size_t i = 0; i < 4; ++i) {
+        clients.emplace_back([&] {
+          const int fd = connect_socket(path);
+          assert(fd != -1);
+          for (size_t j = 0; j < 8; ++j) {
+            assert(send_request(fd, names) == expected);
+          }
+          assert(send_request(fd, {}) == "");
+          ::close(fd);
+        });
+      }
+    }
+  }
+  assert(!std::filesystem::exists(path));
+
+  {
+    // Files other than sockets are not replaced
+    std::ofstream{path} << "test";
+    Server server{{}, OutputFormat::Json, 1};
+    assert(!server.listen(path));
+    std::filesystem::remove(path);
+  }
+#endif
+}
+
+void test_token_index() {
+  using namespace anitomy::detail;
+
+  Tokenizer t{"Season 2 - 03 [TV]"};
+  t.tokenize({});
+
+  TokenIndex index;
+  index.build(t.tokens());
+
+  const auto& tokens = t.tokens();
+  assert(std::ranges::equal(index.numbers(), std::array{2uz, 6uz}));
+  assert(std::ranges::equal(index.keywords(KeywordKind::Season), std::array{0uz}));
+  assert(std::ranges::equal(index.keywords(KeywordKind::Type), std::array{9uz}));
+  assert(index.keywords(KeywordKind::Episode).empty());
+  assert(index.next_non_delimiter(2) == 6);
+  assert(index.prev_non_delimiter(6) == 2);
+  assert(index.next_non_delimiter(tokens.size() - 1) == tokens.size());
+  assert(index.prev_non_delimiter(0) == tokens.size());
 }
 
 void test_tokenizer() {
@@ -239,6 +1130,35 @@ void test_tokenizer() {
       assert(t.tokens()[i].value == tokens[i].second);
     }
   }
+  {
+    const std::string_view input{"[Group] Title - 01"};
+    Tokenizer t{input};
+    t.tokenize(options);
+    for (const auto& token : t.tokens()) {
+      assert(token.value.data() == input.data() + token.position);  // slice of the input
+    }
+  }
+  {
+    Tokenizer t{"Episódio 01"};
+    t.tokenize(options);
+    assert(t.tokens().size() == 3);
+    assert(t.tokens()[0].kind == TokenKind::Keyword);
+    assert(t.tokens()[0].value == "Episódio");
+    assert(t.tokens()[2].value == "01");
+  }
+  {
+    // Brackets are matched regardless of their type, and unmatched ones are left without a pair
+    Tokenizer t{"]a[b(c)]("};
+    t.tokenize(options);
+    const auto& tokens = t.tokens();
+    constexpr auto npos = std::string_view::npos;
+    assert(tokens[0].matching_bracket == npos);
+    assert(tokens[2].matching_bracket == 7 && tokens[7].matching_bracket == 2);
+    assert(tokens[4].matching_bracket == 6 && tokens[6].matching_bracket == 4);
+    assert(tokens[8].matching_bracket == npos);
+    assert(tokens[2].depth == 0 && tokens[4].depth == 1 && tokens[6].depth == 1);
+    assert(tokens[7].depth == 0 && tokens[8].depth == 0);
+  }
 }
 
 void test_unicode() {
@@ -405,6 +1325,22 @@ void test_util() {
   assert(to_lower('a') == 'a');
   assert(to_lower('1') == '1');
   assert(to_lower('\0') == '\0');
+
+  assert(take_lines("", 4) == "");
+  assert(take_lines("ab\ncd\nef", 0) == "ab\n");
+  assert(take_lines("ab\ncd\nef", 3) == "ab\n");
+  assert(take_lines("ab\ncd\nef", 4) == "ab\ncd\n");
+  assert(take_lines("ab\ncd\nef", 7) == "ab\ncd\nef");
+  assert(take_lines("abcdef", 2) == "abcdef");
+
+  {
+    std::vector<std::string_view> lines;
+    for_each_line("a\r\n\nb\n", [&lines](std::string_view line) { lines.push_back(line); });
+    assert((lines == std::vector<std::string_view>{"a", "", "b"}));
+    lines.clear();
+    for_each_line("a\nb", [&lines](std::string_view line) { lines.push_back(line); });
+    assert((lines == std::vector<std::string_view>{"a", "b"}));
+  }
 }
 
 void test_data() {
@@ -480,9 +1416,25 @@ int main(int argc, char* argv[]) {
   if (arg == "--test-data") {
     test_data();
   } else {
+    test_batch();
+    test_batch_file();
+    test_cache();
     test_cli();
+    test_columnar();
+    test_disk_cache();
+    test_engine();
     test_json();
+    test_keyword();
+    test_mapped_file();
+    test_matcher();
+    test_number();
     test_parser();
+    test_pmr();
+    test_profile();
+    test_result();
+    test_scan();
+    test_server();
+    test_token_index();
     test_tokenizer();
     test_unicode();
     test_util();
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <anitomy.hpp>
+#include <anitomy/detail/json.hpp>
+#include <anitomy/detail/util.hpp>
+
+// Parses the test data from multiple threads at once, and compares the results with those of a
+// single-threaded run. Meant to be built with ThreadSanitizer (see `ANITOMY_SANITIZE_THREAD`).
+
+namespace {
+
+struct Item {
+  std::string input;
+  std::vector<anitomy::Element> elements;
+};
+
+size_t get_option(int argc, char* argv[], std::string_view name, size_t default_value) {
+  for (std::string_view arg : std::span{argv, static_cast<size_t>(argc)}) {
+    if (arg.starts_with(name) && arg.substr(name.size()).starts_with('=')) {
+      arg.remove_prefix(name.size() + 1);
+      size_t value{0};
+      std::from_chars(arg.data(), arg.data() + arg.size(), value);
+      return value ? value : default_value;
+    }
+  }
+  return default_value;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  using namespace anitomy::detail;
+
+  const size_t thread_count =
+      get_option(argc, argv, "--threads", std::max(std::thread::hardware_concurrency(), 4u));
+  const size_t iterations = get_option(argc, argv, "--iterations", 20);
+
+  std::string file;
+  if (!read_file("data.json", file)) {
+    std::println("Cannot read test data");
+    return 1;
+  }
+
+  auto data = json::parse(file);
+  if (!data.is_array()) {
+    std::println("Invalid test data");
+    return 1;
+  }
+
+  std::vector<Item> items;
+  for (auto& item : data.as_array()) {
+    auto input = item.as_object()["input"].as_string();
+    auto elements = anitomy::parse(input);
+    items.emplace_back(std::move(input), std::move(elements));
+  }
+
+  std::atomic<size_t> failures{0};
+
+  {
+    std::vector<std::jthread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&, i] {
+        for (size_t n = 0; n < iterations; ++n) {
+          // Each thread starts at a different offset, so that the same input is not always
+          // being parsed at the same time.
+          for (size_t j = 0; j < items.size(); ++j) {
+            const auto& item = items[(i * items.size() / thread_count + j) % items.size()];
+            if (anitomy::parse(item.input) != item.elements) {
+              failures.fetch_add(1, std::memory_order_relaxed);
+            }
+          }
+        }
+      });
+    }
+  }
+
+  {
+    std::vector<std::string_view> inputs;
+    for (size_t n = 0; n < iterations; ++n) {
+      for (const auto& item : items) inputs.emplace_back(item.input);
+    }
+    const auto results =
+        anitomy::parse_batch(inputs, {}, {.thread_count = thread_count, .chunk_size = 16});
+    for (size_t i = 0; i < results.size(); ++i) {
+      if (results[i] != items[i % items.size()].elements) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  const size_t parse_count = (thread_count + 1) * iterations * items.size();
+
+  if (failures > 0) {
+    std::println("Failed {} of {} parses on {} threads", failures.load(), parse_count,
+                 thread_count);
+    return 1;
+  }
+
+  std::println("Passed {} parses on {} threads", parse_count, thread_count);
+
+  return 0;
+}